@@ -9,12 +9,11 @@
 // *
 // *    Cluster.h
 // *
-// *    Class that defines Cluster objects. Clusters are not
-// *    defined as a list of RPCHits but it could one of the
-// *    next updates of the code. For now only saving info
-// *    extracted from the RPCHit list is enough (first and
-// *    lest strips, center, cluster size, time stamps of the
-// *    hits, etc...).
+// *    Building of the clusters of the hits of an event. The
+// *    clusters are not kept as objects : only their size and
+// *    their number are needed to fill the histograms, so they
+// *    are counted while the hits of each partition are grouped
+// *    by time and by adjacent strips.
 // *
 // *    Developped by : Alexis Fagot & Salvador Carillo
 // *    22/06/2017
@@ -25,43 +24,48 @@
 #include "TH1.h"
 #include "types.h"
 #include "RPCHit.h"
+#include "MultCounter.h"
+#include "FlatHisto.h"
 
 using namespace std;
 
-class RPCCluster{
+//Word of the strip occupancy bitmask of a time group
+typedef unsigned long long StripWord;
+
+//Builds the clusters of index ranges of a hit store without copying
+//the hits nor creating cluster objects : only the cluster sizes and
+//multiplicity are needed to fill the histograms. The index buffer is
+//kept from one call to the next so that there is no allocation once
+//the largest partition occupancy has been seen.
+//The hits of each time group are set into a strip occupancy bitmask
+//in which clusters are the runs of consecutive set bits. The kernel
+//is specialised on the number of 64-bit words of the mask, i.e. one
+//word for the 16/32/48/64 strip partitions and two for 128 strips.
+//Wider partitions fall back on sorting the hits by strip.
+//The hits are put in time order by merging the time ordered runs in
+//which they come out of the TDCs, or by a sort when the hits are too
+//far from being ordered.
+class ClusterBuilder {
     private:
-        Uint  ClusterID;    //Cluster ID (not used here)
-        Uint  ClusterSize;  //Size of cluster #ID
-        Uint  FirstStrip;   //First strip of cluster #ID
-        Uint  LastStrip;    //Last strip of cluster #ID
-        float Center;       //Center of cluster #ID ((first+last)/2)
-        float StartStamp;   //Time stamp of the earliest hit of cluster #ID
-        float StopStamp;    //Time stamp of the latest hit of cluster #ID
-        float TimeSpread;   //Time difference between earliest and latest hits
-                            //of cluster #ID
-    public:
-        //Constructors, destructor & operator =
-        RPCCluster();
-        RPCCluster(HitList List, Uint cID, Uint cSize, Uint first, Uint firstID);
-        RPCCluster(const RPCCluster& other);
-        ~RPCCluster();
-        RPCCluster& operator=(const RPCCluster& other);
+        vector<Uint> HitIDs;  //Indices of the hits being clusterized
+        vector<Uint> Merged;  //Buffer of the merge of the time ordered runs
+        vector<Uint> RunEnds; //End of each time ordered run of HitIDs
+        vector<Uint> Doubles; //Strips hit more than once in a time group
 
-        //Get GIFTrolley members
-        Uint GetID();
-        Uint GetSize();
-        Uint GetFirstStrip();
-        Uint GetLastStrip();
-        float GetCenter();
-        float GetStart();
-        float GetStop();
-        float GetSpread();
-};
+        void OrderInTime(const HitStore &hits, Uint first, Uint last);
 
-typedef vector<RPCCluster> ClusterList;
+        template<Uint NWORDS>
+        Uint BuildGroup(const HitStore &hits, Uint* hitIDs, Uint nHits, FlatH1 &hcSize);
+        template<Uint NWORDS>
+        void ClusterizeGroups(const HitStore &hits, Uint first, Uint last,
+                              FlatH1 &hcSize, MultCounter &hcMult);
 
-//Other functions to build cluster lists out of hit lists
-void BuildClusters(HitList &cluster, ClusterList &clusterList);
-void Clusterization(HitList &hits, TH1 *hcSize, TH1 *hcMult);
+    public:
+        ClusterBuilder();
+        ~ClusterBuilder();
+
+        void Clusterize(const HitStore &hits, Uint first, Uint last, Uint nStrips,
+                        FlatH1 &hcSize, MultCounter &hcMult);
+};
 
 #endif
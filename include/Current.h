@@ -17,8 +17,11 @@
 
 #include <string>
 
+#include "Infrastructure.h"
+
 using namespace std;
 
 void GetCurrent(string baseName);
+void GetCurrent(string baseName, Infrastructure* Infra);
 
 #endif // CURRENT_H
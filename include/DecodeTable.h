@@ -0,0 +1,65 @@
+#ifndef __DECODETABLE_H_
+#define __DECODETABLE_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    DecodeTable.h
+// *
+// *    Class that defines DecodeTable objects. They are built
+// *    once from the Mapping and the PartitionTable and give
+// *    for each TDC channel the trolley, slot, partition and
+// *    strip it is connected to, so that the event loops don't
+// *    need to look into the infrastructure for every hit.
+//***************************************************************
+
+#include <vector>
+
+#include "types.h"
+#include "Mapping.h"
+#include "PartitionTable.h"
+
+using namespace std;
+
+//****************************************************************************
+
+//Everything the analysis needs to know about a TDC channel packed
+//into 8 bytes. Channels that are not linked to any partition of the
+//infrastructure have Partition = 0.
+typedef struct ChannelCode {
+    unsigned char  Trolley;   //Trolley ID (T of TSCCC)
+    unsigned char  Slot;      //Slot ID (S of TSCCC)
+    unsigned char  Partition; //Partition from 1, 0 if no link
+    unsigned short Strip;     //RPC strip (CCC of TSCCC)
+    unsigned short Index;     //Dense index of the partition
+} ChannelCode;
+
+//****************************************************************************
+
+class DecodeTable {
+    private:
+        vector<ChannelCode> Table;       //Codes indexed by TDC channel
+        Uint                LastChannel; //Index of the empty code
+        Uint                nPartitions; //Number of active partitions
+
+    public:
+        DecodeTable();
+        DecodeTable(Mapping* RPCChMap, PartitionTable* Parts);
+        ~DecodeTable();
+
+        Uint GetNPartitions();
+        const ChannelCode& Decode(Uint tdcchannel) const;
+};
+
+// *************************************************************************************************************
+
+//Lookup used by the event loops. As for the Mapping, every channel
+//beyond the table is sent to its last code that is always empty.
+inline const ChannelCode& DecodeTable::Decode(Uint tdcchannel) const {
+    return Table[(tdcchannel < LastChannel) ? tdcchannel : LastChannel];
+}
+
+#endif
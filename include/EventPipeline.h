@@ -0,0 +1,77 @@
+#ifndef __EVENTPIPELINE_H_
+#define __EVENTPIPELINE_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    EventPipeline.h
+// *
+// *    Reading stage of the pipelined loop over the entries.
+// *    A single reader thread reads, decompresses and unpacks
+// *    the entries of the RAWData tree ahead into chunks of
+// *    compact event records. The chunks are handed over to the
+// *    analysis threads through bounded lock-free rings (one
+// *    producer, one consumer each) whose slots keep their
+// *    memory from one chunk to the next. A thread finding its
+// *    ring full or empty retries a few times and then sleeps
+// *    until the other side moves.
+//***************************************************************
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "TTree.h"
+
+#include "types.h"
+
+using namespace std;
+
+//Number of entries per chunk handed over to an analysis thread
+const Uint PIPECHUNK = 64;
+
+//Default number of chunks read ahead for each analysis thread
+const Uint PIPEDEPTH = 8;
+
+//Number of times a thread looks again at a full or empty ring
+//before going to sleep
+const Uint PIPESPIN = 64;
+
+//****************************************************************************
+
+class ChunkRing {
+    private:
+        vector<RAWDataBuffer> Slots;   //Chunks, reused once analysed
+        atomic<Uint>          Head;    //Number of chunks taken by the consumer
+        atomic<Uint>          Tail;    //Number of chunks given by the producer
+        atomic<bool>          Closed;  //No more chunk will be given
+        atomic<Uint>          nAsleep; //Number of threads sleeping on Changed
+        mutex                 Lock;    //Only used to sleep and wake up
+        condition_variable    Changed; //Notified by Push(), Pop() and Close()
+
+        void Wake();
+
+    public:
+        ChunkRing(Uint depth);
+        ~ChunkRing();
+
+        RAWDataBuffer* GetWriteSlot();
+        RAWDataBuffer* WaitWriteSlot();
+        void           Push();
+        RAWDataBuffer* GetReadSlot();
+        RAWDataBuffer* WaitReadSlot();
+        void           Pop();
+        void           Close();
+        bool           IsClosed() const;
+};
+
+//****************************************************************************
+
+void ReadChunks(TTree* dataTree, Uint first, Uint last, bool isNewFormat,
+                vector<ChunkRing*>& Rings);
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef __FLATHISTO_H_
+#define __FLATHISTO_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    FlatHisto.h
+// *
+// *    Classes that define FlatH1 and FlatH2 objects. These
+// *    are fixed binning accumulators filled in the loop over
+// *    the entries in place of ROOT histograms : the bin is
+// *    computed directly (or given by the caller for strips)
+// *    and the contents are plain integer arrays, allocated
+// *    the first time the accumulator is filled. The ROOT
+// *    histogram is only booked once the loop is over, with
+// *    the same entries and statistics as if it had been
+// *    filled.
+//***************************************************************
+
+#include <vector>
+#include <iostream>
+
+#include "TH1.h"
+#include "TH2.h"
+#include "types.h"
+
+using namespace std;
+
+//Fixed binning of an axis
+typedef struct FlatAxis {
+    int    nBins; //Number of bins (without under/overflow)
+    double Low;   //Low edge of the axis
+    double High;  //High edge of the axis
+
+    //Same bin as TAxis::FindBin for a fixed binning
+    inline int FindBin(double x) const {
+        if(x < Low) return 0;
+        else if(!(x < High)) return nBins+1;
+        else return 1 + int(nBins*(x-Low)/(High-Low));
+    }
+} FlatAxis;
+
+class FlatH1 {
+    private:
+        FlatAxis     Axis;    //Binning of the histogram
+        vector<Uint> Content; //Bin contents, 0 and nBins+1 being under/overflow
+                              //(empty until the first fill)
+        double       Entries; //Number of fills
+        double       SumW;    //Statistics of the fills inside of the axis
+        double       SumWX;
+        double       SumWX2;
+
+    public:
+        FlatH1();
+        ~FlatH1();
+
+        void SetBinning(int nbins, double low, double high);
+        void Reset();
+        void Add(const FlatH1& other);
+        void CopyTo(TH1* H) const;
+        TH1* MakeTH1F(const char* name, const char* title) const;
+        TH1* MakeTH1I(const char* name, const char* title) const;
+        void Save(ostream& out) const;
+        bool Load(istream& in);
+
+        //Fill value x into bin, the caller knowing that it
+        //belongs to the axis (e.g. the bin of a strip)
+        inline void FillBin(int bin, double x){
+            if(Content.empty()) Content.assign(Axis.nBins+2,0);
+
+            Entries++;
+            Content[bin]++;
+            SumW++;
+            SumWX  += x;
+            SumWX2 += x*x;
+        }
+
+        inline void Fill(double x){
+            int bin = Axis.FindBin(x);
+
+            if(bin == 0 || bin > Axis.nBins){
+                if(Content.empty()) Content.assign(Axis.nBins+2,0);
+
+                Entries++;
+                Content[bin]++;
+            } else
+                FillBin(bin,x);
+        }
+};
+
+class FlatH2 {
+    private:
+        FlatAxis     X;       //Binning along X
+        FlatAxis     Y;       //Binning along Y
+        vector<Uint> Content; //Bin contents, global bin as in TH2
+                              //(empty until the first fill)
+        double       Entries; //Number of fills
+        double       SumW;    //Statistics of the fills inside of the axes
+        double       SumWX;
+        double       SumWX2;
+        double       SumWY;
+        double       SumWY2;
+        double       SumWXY;
+
+    public:
+        FlatH2();
+        ~FlatH2();
+
+        void SetBinning(int nbinsx, double xlow, double xhigh,
+                        int nbinsy, double ylow, double yhigh);
+        void Reset();
+        void Add(const FlatH2& other);
+        void CopyTo(TH2* H) const;
+        TH2* MakeTH2F(const char* name, const char* title) const;
+        void Save(ostream& out) const;
+        bool Load(istream& in);
+
+        //Fill (x,y) knowing that x belongs to bin binx of
+        //the X axis (e.g. the bin of a strip)
+        inline void FillBinX(int binx, double x, double y){
+            int biny = Y.FindBin(y);
+
+            if(Content.empty()) Content.assign((X.nBins+2)*(Y.nBins+2),0);
+
+            Entries++;
+            Content[binx + (X.nBins+2)*biny]++;
+
+            if(biny == 0 || biny > Y.nBins) return;
+
+            SumW++;
+            SumWX  += x;
+            SumWX2 += x*x;
+            SumWY  += y;
+            SumWY2 += y*y;
+            SumWXY += x*y;
+        }
+};
+
+typedef PartitionArray<FlatH1> GIFFlatH1Array;
+typedef PartitionArray<FlatH2> GIFFlatH2Array;
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef __FOLLOWANALYSIS_H_
+#define __FOLLOWANALYSIS_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    FollowAnalysis.h
+// *
+// *    Online analysis of a DAQ file while it is still being
+// *    written. The RAWData tree is refreshed periodically and
+// *    only the new entries are looped over, the loop histograms
+// *    being kept in memory. Snapshots of the results are
+// *    published at regular intervals and the final results are
+// *    written as by the offline analysis once the run is over.
+//***************************************************************
+
+#include <string>
+
+#include "types.h"
+#include "OfflineAnalysis.h"
+
+using namespace std;
+
+//Default time between two snapshots of the results (s)
+const Uint FOLLOWPERIOD = 60;
+
+//Default time without new entries after which the run is
+//considered to be over (s)
+const Uint FOLLOWIDLE = 600;
+
+//Time between two refreshes of the RAWData tree (s)
+const Uint FOLLOWPOLL = 2;
+
+//Number of entries the muon peak of efficiency runs is searched
+//on. The time windows are then kept until the end of the run.
+const Uint FOLLOWPEAKENTRIES = 5000;
+
+//Name of the snapshots of the CSV files, next to the DAQ file
+//(baseName + __online + Rate.csv, Corrupted.csv or L0-EffCl.csv)
+const string __online = "_Online-";
+
+//****************************************************************************
+
+void FollowAnalysis(string baseName, AnalysisOptions& options, Uint period, Uint idle);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef __HITARENA_H_
+#define __HITARENA_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    HitArena.h
+// *
+// *    Class that defines HitArena objects. The arena collects
+// *    the hits of an event for all the active partitions of
+// *    the infrastructure into a single hit store. The hits
+// *    are first staged in reading order while counting them
+// *    per partition and then scattered into contiguous index
+// *    ranges of the store, one per partition (peak hits first
+// *    and then noise hits). The memory of the arena is kept
+// *    from one event to the next.
+//***************************************************************
+
+#include <vector>
+
+#include "types.h"
+#include "RPCHit.h"
+
+using namespace std;
+
+//****************************************************************************
+
+//Hit waiting to be scattered into the store
+typedef struct StagedHit {
+    unsigned short Index; //Dense index of the partition
+    unsigned char  Peak;  //1 if in the muon peak window
+    unsigned char  Strip; //Strip inside of the partition, from 0
+    float          Time;
+} StagedHit;
+
+//****************************************************************************
+
+class HitArena {
+    private:
+        vector<StagedHit> Staged;      //Hits of the event in reading order
+        vector<Uint>      nHits;       //Number of hits per partition
+        vector<Uint>      nPeak;       //Number of peak hits per partition
+        vector<Uint>      nFake;       //Number of hits in the fake window per partition
+        vector<Uint>      Offset;      //Start of each partition range in the store
+        vector<Uint>      PeakCursor;  //Next peak position per partition
+        vector<Uint>      NoiseCursor; //Next noise position per partition
+        HitStore          Hits;        //Hits ordered by partition
+
+    public:
+        HitArena();
+        HitArena(Uint nPartitions);
+        ~HitArena();
+
+        void Clear();
+        void Stage(Uint index, Uint strip, float time, bool peak, bool fake);
+        void Scatter();
+
+        const HitStore& GetHits() const;
+        Uint GetNHits(Uint index) const;
+        Uint GetNPeak(Uint index) const;
+        Uint GetNFake(Uint index) const;
+        Uint GetFirstPeak(Uint index) const;
+        Uint GetFirstNoise(Uint index) const;
+        Uint GetLastNoise(Uint index) const;
+};
+
+// *************************************************************************************************************
+
+//Called for every hit of the event loop. The hit is counted for its
+//partition and kept in reading order until Scatter() is called.
+inline void HitArena::Stage(Uint index, Uint strip, float time, bool peak, bool fake){
+    StagedHit hit = {(unsigned short)index, (unsigned char)peak, (unsigned char)strip, time};
+    Staged.push_back(hit);
+
+    nHits[index]++;
+    nPeak[index] += peak;
+    nFake[index] += fake;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef __HITCACHE_H_
+#define __HITCACHE_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    HitCache.h
+// *
+// *    Compact hit cache of a DAQ file used to analyse the same
+// *    file again without reading and decompressing the ROOT
+// *    file. The hits are stored already decoded into the dense
+// *    index of their partition and their strip, with a table
+// *    giving the first hit of each entry. The file is mapped
+// *    into memory and read in place. The cache is only valid
+// *    for the DAQ file, mapping and geometry it was made with.
+//***************************************************************
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "types.h"
+#include "DecodeTable.h"
+
+using namespace std;
+
+//Name of the cache file, next to the DAQ file (baseName + __hitcache)
+const string __hitcache = "_DAQ.hits";
+
+//Version of the format. It has to be increased every time the
+//format or the way the hits are decoded changes.
+const Uint HITCACHEVERSION = 2;
+
+//Flag added to the partition index of the hits that are not used
+//for the muon peak search (TDC channels beyond the connected ones)
+const unsigned short NOBEAMHIT = 0x8000;
+
+//Everything the cache depends on. A cache made with different keys
+//is out of date.
+typedef struct HitCacheKeys {
+    unsigned long long DAQKey;        //Size and modification time of the DAQ files
+                                      //(UUID and entries for the partials)
+    unsigned long long MappingKey;    //Hash of ChannelsMapping.csv
+    unsigned long long DimensionsKey; //Hash of Dimensions.ini
+    Uint               nEntries;      //Number of entries of the RAWData trees
+    Uint               nPartitions;   //Number of active partitions
+} HitCacheKeys;
+
+//Header at the beginning of the file. The sections follow, each
+//starting at a multiple of 8 bytes :
+//->EntryOffset : first hit of each entry (nEntries+1 Uint)
+//->Corrupted   : 1 if the entry is corrupted (nEntries bytes)
+//->Index       : dense partition index of each hit (nHits shorts)
+//->Strip       : RPC strip of each hit (nHits shorts)
+//->Time        : time stamp of each hit (nHits floats)
+typedef struct HitCacheHeader {
+    char               Magic[8];
+    Uint               Version;
+    Uint               nHits;
+    HitCacheKeys       Keys;
+    unsigned long long EntryOffsetPos;
+    unsigned long long CorruptedPos;
+    unsigned long long IndexPos;
+    unsigned long long StripPos;
+    unsigned long long TimePos;
+    unsigned long long FileSize;
+} HitCacheHeader;
+
+//****************************************************************************
+
+class HitCache {
+    private:
+        char*                 Map;         //Content of the file mapped into memory
+        size_t                MapSize;
+        const HitCacheHeader* Header;
+        const Uint*           EntryOffset;
+        const unsigned char*  Corrupted;
+        const unsigned short* Index;
+        const unsigned short* Strip;
+        const float*          Time;
+
+    public:
+        HitCache();
+        ~HitCache();
+
+        bool Open(string cacheName, const HitCacheKeys& keys);
+        void Close();
+        bool IsOpen() const;
+
+        Uint  GetNEntries() const;
+        Uint  GetNHits() const;
+        Uint  GetFirstHit(Uint entry) const;
+        bool  IsCorrupted(Uint entry) const;
+        Uint  GetIndex(Uint hit) const;
+        bool  IsBeamHit(Uint hit) const;
+        Uint  GetStrip(Uint hit) const;
+        float GetTime(Uint hit) const;
+};
+
+//****************************************************************************
+
+void GetHitCacheKeys(const vector<string>& daqNames, string mappath, string dimpath,
+                     Uint nEntries, Uint nPartitions, HitCacheKeys& keys);
+bool WriteHitCache(string cacheName, RAWDataBuffer& buffer, DecodeTable* Decoder,
+                   const HitCacheKeys& keys);
+
+// *************************************************************************************************************
+
+//The getters are called for every hit of the event loop and are
+//therefore defined inline. The entry after the last one gives the
+//total number of hits.
+inline Uint  HitCache::GetFirstHit(Uint entry) const { return EntryOffset[entry]; }
+inline bool  HitCache::IsCorrupted(Uint entry) const { return Corrupted[entry]; }
+inline Uint  HitCache::GetIndex(Uint hit) const { return Index[hit] & ~NOBEAMHIT; }
+inline bool  HitCache::IsBeamHit(Uint hit) const { return !(Index[hit] & NOBEAMHIT); }
+inline Uint  HitCache::GetStrip(Uint hit) const { return Strip[hit]; }
+inline float HitCache::GetTime(Uint hit) const { return Time[hit]; }
+
+#endif
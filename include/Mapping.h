@@ -20,6 +20,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "types.h"
 
@@ -35,8 +36,7 @@ const int MAP_ERROR_CANNOT_OPEN_READ_FILE   = 10;
 // *************************************************************************************************************
 
 typedef map<Uint,Uint> MappingData;
-
-// *************************************************************************************************************
+typedef vector<Uint>   MappingTable;
 
 class Mapping {
     private:
@@ -46,8 +46,12 @@ class Mapping {
         MappingData Link;
         MappingData ReverseLink;
         MappingData Mask;
+        MappingTable Table;
+        Uint        LastChannel;
         int         Error;
 
+        void        BuildTable();
+
     public:
         Mapping();
         Mapping(string baseName);
@@ -58,6 +62,17 @@ class Mapping {
         Uint GetLink(Uint tdcchannel);
         Uint GetReverse(Uint rpcchannel);
         Uint GetMask(Uint rpcchannel);
+        Uint GetTableSize() const;
+        Uint Decode(Uint tdcchannel) const;
 };
 
+// *************************************************************************************************************
+
+//Lookup used by the event loops. Every channel beyond the table is
+//sent to its last word that is always empty (no link) so that no
+//branch is needed.
+inline Uint Mapping::Decode(Uint tdcchannel) const {
+    return Table[(tdcchannel < LastChannel) ? tdcchannel : LastChannel];
+}
+
 #endif
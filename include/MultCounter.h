@@ -0,0 +1,55 @@
+#ifndef __MULTCOUNTER_H_
+#define __MULTCOUNTER_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    MultCounter.h
+// *
+// *    Class that defines MultCounter objects. A counter
+// *    collects a multiplicity distribution (number of hits or
+// *    of clusters per event) as plain integers during the
+// *    loop over the entries. Its range grows with the largest
+// *    multiplicity filled and the ROOT histogram is only built
+// *    once the loop is over, with its final range.
+//***************************************************************
+
+#include <vector>
+#include <iostream>
+
+#include "TH1.h"
+#include "types.h"
+
+using namespace std;
+
+//Minimal number of bins of the multiplicity histograms. When the
+//multiplicity goes beyond, the range is extended to the largest
+//multiplicity + this number of bins.
+const Uint MINMULTBINS = 10;
+
+class MultCounter {
+    private:
+        vector<Uint> Counts; //Number of events for each multiplicity
+
+    public:
+        MultCounter();
+        ~MultCounter();
+
+        inline void Fill(Uint mult){
+            if(mult >= Counts.size()) Counts.resize(mult+1,0);
+            Counts[mult]++;
+        }
+
+        void Add(const MultCounter& other);
+        Uint GetNBins() const;
+        TH1* MakeHisto(const char* name, const char* title, Uint nBins) const;
+        void Save(ostream& out) const;
+        bool Load(istream& in);
+};
+
+typedef PartitionArray<MultCounter> GIFMultArray;
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef __MULTFIT_H_
+#define __MULTFIT_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    MultFit.h
+// *
+// *    Fits of the hit multiplicity of old format files (no
+// *    quality flag) used to estimate the amount of corrupted
+// *    data. The fits of the partitions are shared by several
+// *    threads and their results are kept in a cache file
+// *    keyed by the minimizer and the content of the
+// *    multiplicity histograms so that the same file is never
+// *    fitted twice.
+//***************************************************************
+
+#include <string>
+#include <map>
+
+#include "TH1.h"
+
+#include "types.h"
+
+using namespace std;
+
+//Skew fit : gaussian divided by a sigmoid to introduce an asymmetry
+#define SKEWFORMULA "[0]*exp(-0.5*((x-[1])/[2])**2) / (1 + exp(-[3]*(x-[4])))"
+
+//Number of parameters of the skew fit
+const Uint NSKEWPARS = 5;
+
+//Name of the cache file, in the directory of the scan
+const string __skewcache = "/Offline-SkewFit-Cache.csv";
+
+//Parameters of the skew fit of a hit multiplicity histogram
+typedef struct SkewParams {
+    double Par[NSKEWPARS];
+} SkewParams;
+
+typedef PartitionArray<SkewParams>          GIFSkewArray;
+typedef map<unsigned long long, SkewParams> SkewCache;
+
+//****************************************************************************
+
+unsigned long long GetMultKey(TH1* H);
+double EvalSkew(const SkewParams& skew, double x);
+void   FitSkew(TH1* H, double Xmax, Uint id, SkewParams& skew);
+void   ReadSkewCache(string cacheName, SkewCache& cache);
+void   WriteSkewCache(string cacheName, SkewCache& cache);
+void   FitMultiplicities(GIFH1Array& HitMultiplicity, GIFnBinsMult& nBinsMult,
+                         Uint nThreads, string cacheName, GIFSkewArray& Skews);
+
+#endif
@@ -21,9 +21,159 @@
 //***************************************************************
 
 #include <string>
+#include <vector>
+
+#include "TTree.h"
+#include "TString.h"
+
+#include "types.h"
+#include "IniFile.h"
+#include "Mapping.h"
+#include "DecodeTable.h"
+#include "PartitionTable.h"
+#include "HitArena.h"
+#include "MultCounter.h"
+#include "FlatHisto.h"
+#include "EventPipeline.h"
+#include "HitCache.h"
+#include "Infrastructure.h"
 
 using namespace std;
 
-void OfflineAnalysis(string baseName);
+//****************************************************************************
+
+//Histograms filled inside of the event loop. When the loop is split
+//over several threads, each worker fills its own copy of this set
+//that is merged back into the main set at the end of the loop.
+//The histograms are collected into flat accumulators and counters
+//out of which the ROOT histograms are booked once the loop is over.
+typedef struct GIFLoopHistos {
+    GIFFlatH1Array TimeProfile;
+    GIFFlatH1Array HitProfile;
+    GIFMultArray   HitMultiplicity;
+    GIFFlatH2Array TimeVSChanProfile;
+    GIFFlatH1Array StripNoiseProfile;
+    GIFFlatH1Array NoiseCSize;
+    GIFMultArray   NoiseCMult;
+    GIFFlatH1Array BeamProfile;
+    GIFFlatH1Array EfficiencyFake;
+    GIFFlatH1Array EfficiencyPeak;
+    GIFFlatH1Array PeakCSize;
+    GIFMultArray   PeakCMult;
+} GIFLoopHistos;
+
+//Results of the loop over the entries of a HV step : everything the
+//analysis needs once the loop is over. They are also the content of
+//the partial results of a range of entries (see PartialResults.h).
+typedef struct LoopResults {
+    RunMode       Mode;         //Efficiency or rate run
+    bool          isNewFormat;  //DAQ file with a quality flag
+    Uint          nFileEntries; //Number of entries of the DAQ file
+    Uint          First;        //Entries [First,Last[ looped over
+    Uint          Last;
+    muonPeak      PeakHeight;   //Muon peak found on the whole DAQ file
+    muonPeak      PeakTime;
+    muonPeak      PeakWidth;
+    GIFLoopHistos LoopH;
+} LoopResults;
+
+//Results of the analysis of a partition written into the CSV
+//files once all the partitions have been analysed
+typedef struct PartitionResults {
+    float CorruptRatio;     //Percentage of corrupted data
+    float MeanPartRate;     //Mean noise/gamma rate (Hz/cm2)
+    float cSizePart;        //Noise/gamma cluster size
+    float cSizePartErr;
+    float cMultPart;        //Noise/gamma cluster multiplicity
+    float cMultPartErr;
+    float ClustPartRate;    //Noise/gamma cluster rate (Hz/cm2)
+    float ClustPartRateErr;
+    float P_muon;           //L0 muon efficiency (efficiency runs)
+    float P_muon_err;
+    float CS_muon;          //Muon cluster size (efficiency runs)
+    float CS_muon_err;
+    float CM_peak;          //Peak cluster multiplicity (efficiency runs)
+    float CM_peak_err;
+} PartitionResults;
+
+//Geometry, mapping and decoding tables of a scan directory. They
+//only depend on Dimensions.ini and ChannelsMapping.csv and are
+//shared by all the HV steps of the scan.
+typedef struct AnalysisSetup {
+    string          DimPath;    //Path to Dimensions.ini
+    string          MapPath;    //Path to ChannelsMapping.csv
+    IniFile*        Dimensions;
+    Infrastructure* GIFInfra;
+    PartitionTable* Parts;
+    Mapping*        RPCChMap;
+    DecodeTable*    Decoder;
+} AnalysisSetup;
+
+//Headers and rows of the CSV files of the scan produced by the
+//analysis of a HV step. They are kept until they can be written
+//following the order of the HV steps.
+typedef struct AnalysisOutput {
+    string HeadRate; //Offline-Rate-Header.csv
+    string RowRate;  //Offline-Rate.csv
+    string HeadCorr; //Offline-Corrupted-Header.csv
+    string RowCorr;  //Offline-Corrupted.csv
+    string HeadEff;  //Offline-L0-EffCl-Header.csv
+    string RowEff;   //Offline-L0-EffCl.csv
+} AnalysisOutput;
+
+//Range of entries of the loop given to a thread. A range never
+//spans two DAQ files so that each thread only reads one file.
+typedef struct EntryRange {
+    Uint File;  //DAQ file of the entries
+    Uint First; //Entries [First,Last[ of the whole run
+    Uint Last;
+} EntryRange;
+
+//Last entry given to RunLoop(...) to loop over all the entries
+const Uint ALLENTRIES = 0xFFFFFFFF;
+
+//Options of the analysis given through the command line
+typedef struct AnalysisOptions {
+    Uint nThreads;         //Number of threads sharing the loop over the entries
+    bool SinglePass;       //Read the DAQ file once and replay the hits from memory
+    bool Pipeline;         //Read the entries on a thread of its own, ahead of the analysis
+    Uint PrefetchDepth;    //Number of chunks read ahead per analysis thread (pipeline)
+    Uint CacheSizeMB;      //Size of the TTreeCache of the DAQ file (0 : ROOT default)
+    bool MakeHitCache;     //Convert the DAQ file into a hit cache if there is no valid one
+    Uint CheckpointPeriod; //Time between two checkpoints of the loop (s, 0 : no checkpoint)
+    bool SaveFits;         //Add the new multiplicity fits to the cache of the scan (set by
+                           //the analysis, false for the snapshots of follow mode)
+} AnalysisOptions;
+
+//****************************************************************************
+
+void InitLoopHistos(GIFLoopHistos& histos, PartitionTable* Parts, RunMode Mode);
+void CloneLoopHistos(GIFLoopHistos& from, GIFLoopHistos& to);
+void MergeLoopHistos(GIFLoopHistos& into, GIFLoopHistos& from);
+void SetTimeWindows(muonPeak& PeakTime, muonPeak& PeakWidth, GIFWindowArray& Windows);
+void ProcessEntries(TTree* dataTree, Uint first, Uint last, GIFLoopHistos& H,
+                    GIFWindowArray& Windows, RunMode Mode, bool isNewFormat,
+                    DecodeTable* Decoder, PartitionTable* Parts);
+void ProcessBuffer(RAWDataBuffer& buffer, Uint first, Uint last, GIFLoopHistos& H,
+                   GIFWindowArray& Windows, RunMode Mode, DecodeTable* Decoder,
+                   PartitionTable* Parts);
+void ProcessCache(HitCache& Cache, Uint first, Uint last, GIFLoopHistos& H,
+                  GIFWindowArray& Windows, RunMode Mode, DecodeTable* Decoder,
+                  PartitionTable* Parts);
+void ProcessPipeline(TTree* dataTree, Uint first, Uint last, vector<GIFLoopHistos>& WorkerH,
+                     GIFWindowArray& Windows, RunMode Mode, bool isNewFormat,
+                     DecodeTable* Decoder, PartitionTable* Parts, Uint depth);
+void SplitEntries(Uint first, Uint last, Uint nWorkers, const vector<Uint>& FileOffset,
+                  vector<EntryRange>& Ranges);
+void LoadSetup(string scanDir, AnalysisSetup& setup);
+void DeleteSetup(AnalysisSetup& setup);
+void WriteOutput(string scanDir, AnalysisOutput& output);
+bool RunLoop(string baseName, AnalysisOptions& options, AnalysisSetup& setup,
+             Uint firstEntry, Uint lastEntry, LoopResults& R);
+void FinishStep(string baseName, AnalysisOptions& options, AnalysisSetup& setup,
+                LoopResults& R, string rootName, AnalysisOutput& output);
+bool AnalyseStep(string baseName, AnalysisOptions& options, AnalysisSetup& setup,
+                 AnalysisOutput& output);
+void OfflineAnalysis(string baseName, AnalysisOptions& options);
 
 #endif // OFFLINE_H
@@ -0,0 +1,85 @@
+#ifndef __PARTIALRESULTS_H_
+#define __PARTIALRESULTS_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    PartialResults.h
+// *
+// *    Analysis of a HV step split over several processes or
+// *    machines. Each process loops over a range of entries of
+// *    the DAQ file and saves its raw loop results into a
+// *    partial file. The partial files are then merged and the
+// *    rest of the analysis (fits, CSV files, ROOT file) is run
+// *    once on the merged results.
+// *    The muon peak of an efficiency run is searched once and
+// *    saved into a peak file read by all the partials.
+// *    The same files are used as checkpoints of a long loop so
+// *    that an interrupted analysis can be resumed.
+//***************************************************************
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "types.h"
+#include "HitCache.h"
+#include "OfflineAnalysis.h"
+
+using namespace std;
+
+//Name of the partial files, next to the DAQ file
+//(baseName + __partial + first-last + __partialext)
+const string __partial = "_Partial-";
+const string __partialext = ".raw";
+
+//Name of the file holding the muon peak of the run, next to the
+//DAQ file (baseName + __peakfile)
+const string __peakfile = "_Peak.raw";
+
+//Name of the checkpoint of the loop over the entries [first,last[
+//(baseName + __checkpoint + first-last + __partialext)
+const string __checkpoint = "_Checkpoint-";
+
+//Number of entries looped over between two possible checkpoints.
+//The loop histograms are only merged and saved between two blocks.
+const Uint CHECKPOINTENTRIES = 50000;
+
+//Version of the format. It has to be increased every time the
+//format or the content of the loop histograms changes.
+const Uint PARTIALVERSION = 2;
+
+//Header at the beginning of a partial file. It is followed by the
+//muon peak parameters and by the loop histograms of each partition.
+//The keys tell which DAQ file, mapping and geometry the entries were
+//analysed with. Partials can only be merged if their keys are equal.
+//The peak files start with the same header, covering no entry.
+typedef struct PartialHeader {
+    char         Magic[8];
+    Uint         Version;
+    Uint         Mode;        //RunMode of the DAQ file
+    Uint         isNewFormat; //DAQ file with a quality flag
+    Uint         First;       //Entries [First,Last[ looped over
+    Uint         Last;
+    HitCacheKeys Keys;
+} PartialHeader;
+
+//****************************************************************************
+
+string GetPartialName(string baseName, Uint first, Uint last);
+void   GetPartialKeys(const vector<string>& daqNames, string mappath, string dimpath,
+                      Uint nEntries, Uint nPartitions, HitCacheKeys& keys);
+bool   WritePartial(string fileName, const HitCacheKeys& keys, LoopResults& R);
+bool   ReadPartial(string fileName, PartialHeader& header, LoopResults& R);
+bool   WritePeakFile(string fileName, const HitCacheKeys& keys, LoopResults& R);
+bool   ReadPeakFile(string fileName, const HitCacheKeys& keys, LoopResults& R);
+string GetCheckpointName(string baseName, Uint first, Uint last);
+bool   ReadCheckpoint(string fileName, const HitCacheKeys& keys, LoopResults& R);
+void   PeakAnalysis(string baseName, AnalysisOptions& options);
+void   PartialAnalysis(string baseName, AnalysisOptions& options, Uint firstEntry, Uint lastEntry);
+void   MergeAnalysis(string baseName, AnalysisOptions& options);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef __PARTITIONTABLE_H_
+#define __PARTITIONTABLE_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    PartitionTable.h
+// *
+// *    Class that defines PartitionTable objects. The table
+// *    gives a dense index to every active partition of the
+// *    infrastructure (following the trolleys, then the slots
+// *    and finally the partitions) and keeps their names and
+// *    geometry so that the loops over the partitions don't
+// *    need to ask the infrastructure for them. The
+// *    PartitionArray containers are indexed the same way.
+//***************************************************************
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "Infrastructure.h"
+
+using namespace std;
+
+//****************************************************************************
+
+//Name and geometry of an active partition
+typedef struct PartitionInfo {
+    Uint   TrolleyID;  //T of TSCCC
+    Uint   SlotID;     //S of TSCCC
+    Uint   Partition;  //Partition inside of the RPC (0 = A)
+    Uint   RPC;        //Index of the RPC in the table
+    Uint   nStrips;    //Number of strips per partition of the RPC
+    Uint   FirstStrip; //First RPC strip of the partition (from 1)
+    float  StripArea;  //Active area of a strip (cm2)
+    string RPCName;    //Name of the RPC
+    string Name;       //Name of the partition (RPC name + "-A", "-B", ...)
+} PartitionInfo;
+
+//Value returned when a trolley and slot pair is not in the table
+const Uint NOPARTITION = (Uint)-1;
+
+//****************************************************************************
+
+class PartitionTable {
+    private:
+        vector<PartitionInfo> Partitions; //Info of each partition
+        vector<Uint>          RPCFirst;   //Index of the first partition of
+                                          //each RPC (+ total)
+        vector<Uint>          SlotFirst;  //Index of the first partition of
+                                          //the RPC in slot T*10+S
+        vector<string>        RPCNames;   //Name of each RPC
+
+    public:
+        PartitionTable();
+        PartitionTable(Infrastructure* Infra);
+        ~PartitionTable();
+
+        Uint GetNPartitions() const;
+        Uint GetNRPCs() const;
+        Uint GetFirst(Uint rpc) const;
+        Uint GetLast(Uint rpc) const;
+        string GetRPCName(Uint rpc) const;
+        Uint FindFirst(Uint trolleyID, Uint slotID) const;
+        const PartitionInfo& GetInfo(Uint index) const;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef __PEAKFINDER_H_
+#define __PEAKFINDER_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    PeakFinder.h
+// *
+// *    Class that defines PeakFinder objects. A finder gives
+// *    the gaussian parameters of the muon peak of a time
+// *    profile within a time range out of the weighted moments
+// *    of the bins. The Minuit fit of a gaussian is only used
+// *    when the estimate fails its quality check.
+//***************************************************************
+
+#include "TH1.h"
+#include "TF1.h"
+
+#include "types.h"
+
+using namespace std;
+
+//Accepted ranges of the peak parameters. They are the limits the
+//gaussian fit of the muon peak used to be constrained to.
+const float PEAKMINAMPL  = 1.;
+const float PEAKMAXAMPL  = 100000.;
+const float PEAKMINTIME  = 200.;
+const float PEAKMAXTIME  = 400.;
+const float PEAKMINSIGMA = 1.;
+const float PEAKMAXSIGMA = 40.;
+
+//Minimal number of non empty bins and of hits in the time
+//range for the moments to give a trustworthy estimate
+const Uint  PEAKMINBINS  = 3;
+const float PEAKMINHITS  = 10.;
+
+//Gaussian parameters of a muon peak
+typedef struct PeakParams {
+    float Height; //Amplitude of the gaussian
+    float Mean;   //Peak time (ns)
+    float Sigma;  //Peak spread (ns)
+    bool  Fitted; //Parameters given by the Minuit fit
+} PeakParams;
+
+class PeakFinder {
+    private:
+        TF1* Gauss; //Gaussian used for the fits and fallbacks
+
+    public:
+        PeakFinder();
+        ~PeakFinder();
+
+        PeakParams GetDefault() const;
+        bool       Estimate(TH1* H, float low, float high, PeakParams& peak) const;
+        PeakParams Find(TH1* H, float low, float high);
+        void       Draw(TH1* H, const PeakParams& peak, float low, float high) const;
+};
+
+#endif
@@ -28,44 +28,83 @@
 
 #include "types.h"
 #include "Mapping.h"
-#include "Infrastructure.h"
+#include "DecodeTable.h"
+#include "PartitionTable.h"
+#include "HitCache.h"
 
 #include "TTree.h"
 
 using namespace std;
 
-//Hit in the RPC
+//Hit in the RPC. The hit is packed into 12 bytes and is trivially
+//copyable (no user defined copy constructor, operator = or destructor).
 class RPCHit {
     private:
-        Uint  Channel;
-        Uint  Trolley;
-        Uint  Station;
-        Uint  Strip;
-        Uint  Partition;
-        float TimeStamp;
+        unsigned short Strip;     //RPC strip, from 1 to 999
+        unsigned char  Trolley;   //0, 1 or 3
+        unsigned char  Station;   //From 1 to 9
+        unsigned char  Partition; //From 1 to 4
+        float          TimeStamp;
 
     public:
         RPCHit();
-        RPCHit(Uint channel, float time, Infrastructure* Infra);
-        RPCHit(const RPCHit& other);
-        ~RPCHit();
-        RPCHit& operator=(const RPCHit& other);
-
-        Uint  GetChannel();
-        Uint  GetTrolley();
-        Uint  GetStation();
-        Uint  GetStrip();
-        Uint  GetPartition();
-        float GetTime();
+        RPCHit(const ChannelCode& code, float time);
+
+        Uint  GetTrolley() const;
+        Uint  GetStation() const;
+        Uint  GetStrip() const;
+        Uint  GetPartition() const;
+        float GetTime() const;
 };
 
-typedef vector<RPCHit> HitList;
-typedef struct GIFHitList { HitList rpc[NTROLLEYS][NSLOTS][NPARTITIONS]; } GIFHitList;
+//Hits collected during an event and used to build the clusters. Only
+//the strip and the time stamp are needed for that, so they are stored
+//as a structure of arrays : the time ordering and the grouping by strips
+//only need to go through the array they work on. The hits of each
+//partition occupy an index range of the store (see HitArena) and
+//their strips are counted from 0 inside of their partition.
+typedef struct HitStore {
+    vector<unsigned char> Strip;
+    vector<float>         Time;
+
+    Uint size() const { return Time.size(); }
+    void clear(){ Strip.clear(); Time.clear(); }
+} HitStore;
 
-bool SortHitbyStrip(RPCHit h1, RPCHit h2);
-bool SortHitbyTime(RPCHit h1, RPCHit h2);
+//Comparators used to order the indices of the hits of a HitStore
+//without moving the hits themselves
+typedef struct SortStoreByTime {
+    const HitStore& Hits;
+    SortStoreByTime(const HitStore& hits) : Hits(hits) {}
+    bool operator()(Uint i1, Uint i2) const { return Hits.Time[i1] < Hits.Time[i2]; }
+} SortStoreByTime;
 
+typedef struct SortStoreByStrip {
+    const HitStore& Hits;
+    SortStoreByStrip(const HitStore& hits) : Hits(hits) {}
+    bool operator()(Uint i1, Uint i2) const { return Hits.Strip[i1] < Hits.Strip[i2]; }
+} SortStoreByStrip;
+
+void BookBeamProfiles(GIFH1Array &tmpTimeProfile, Uint nPartitions);
+void FillBeamProfile(GIFH1Array &tmpTimeProfile, Uint channel, float timing,
+                     DecodeTable* Decoder);
+void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
+                       TTree* mytree, DecodeTable* Decoder, PartitionTable* Parts);
 void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
-                       TTree* mytree, Mapping* RPCChMap, Infrastructure* Infra);
+                       RAWDataBuffer &buffer, DecodeTable* Decoder, PartitionTable* Parts);
+void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
+                       HitCache &cache, PartitionTable* Parts);
+void FitBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
+                       GIFH1Array &tmpTimeProfile, PartitionTable* Parts);
+
+// *************************************************************************************************************
+
+//The getters are called for every hit of the event loop and are
+//therefore defined inline.
+inline Uint  RPCHit::GetTrolley() const { return Trolley; }
+inline Uint  RPCHit::GetStation() const { return Station; }
+inline Uint  RPCHit::GetStrip() const { return Strip; }
+inline Uint  RPCHit::GetPartition() const { return Partition; }
+inline float RPCHit::GetTime() const { return TimeStamp; }
 
 #endif
@@ -0,0 +1,52 @@
+#ifndef __REPACK_H_
+#define __REPACK_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    Repack.h
+// *
+// *    Rewriting of the DAQ files for the analysis : only the
+// *    branches read by the analysis, the event number and the
+// *    number of hits are kept, with larger baskets and
+// *    clusters and a faster compression codec.
+// *    The repacked file has the same content for the analysis
+// *    and can replace the DAQ file. The read throughput of
+// *    both files is reported.
+//***************************************************************
+
+#include <string>
+
+#include "types.h"
+
+using namespace std;
+
+//Name of the repacked file, next to the DAQ file (baseName + __repacked)
+const string __repacked = "_DAQ-Repacked.root";
+
+//Compression settings (100*algorithm + level) of the repacked files
+const int PACKLZ4  = 404;
+const int PACKZSTD = 505;
+const int PACKZLIB = 101;
+
+//Default basket size (kB) and cluster size (MB) of the repacked files
+const Uint PACKBASKETKB  = 512;
+const Uint PACKCLUSTERMB = 32;
+
+//Options of the repacking given through the command line
+typedef struct RepackOptions {
+    int  Compression; //ROOT compression settings
+    Uint BasketKB;    //Size of the baskets of each branch
+    Uint ClusterMB;   //Size of the entry clusters (auto flush)
+} RepackOptions;
+
+//****************************************************************************
+
+int    GetCompression(string codec);
+double MeasureReading(string fileName, double& megabytes);
+void   RepackDAQFile(string baseName, RepackOptions& options);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef __SCANANALYSIS_H_
+#define __SCANANALYSIS_H_
+
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    ScanAnalysis.h
+// *
+// *    Analysis of all the HV steps of a scan directory in a
+// *    single process. The geometry, mapping and decoding
+// *    tables are built once for the whole scan and several
+// *    HV steps are analysed at once. The CSV files of the
+// *    scan are still written following the order of the HV
+// *    steps.
+//***************************************************************
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "OfflineAnalysis.h"
+
+using namespace std;
+
+//Default number of HV steps analysed at once
+const Uint SCANSTEPS = 2;
+
+//HV step found in the scan directory
+typedef struct ScanStep {
+    Uint   HVstep;   //Number of the HV step
+    string BaseName; //Path to the files without _DAQ.root or _CAEN.root
+    bool   HasDAQ;   //baseName_DAQ.root exists
+    bool   HasCAEN;  //baseName_CAEN.root exists
+} ScanStep;
+
+//****************************************************************************
+
+bool SortStepsByHV(const ScanStep& s1, const ScanStep& s2);
+void FindScanSteps(string scanDir, vector<ScanStep>& Steps);
+void ScanAnalysis(string scanDir, AnalysisOptions& options, Uint nSteps);
+
+#endif
@@ -15,6 +15,9 @@
 // *    07/06/2017
 //***************************************************************
 
+#include <vector>
+#include <string>
+
 #include "TH1.h"
 #include "TH2.h"
 
@@ -33,27 +36,61 @@ const float RDMNOISEWDW  = RDMTDCWINDOW - TIMEREJECT;
 typedef unsigned int Uint;
 const Uint NTROLLEYS   = 5;
 const Uint NSLOTS      = 9;
-const Uint NPARTITIONS = 4;
 
 const Uint NSTRIPSRPC  = 128;
 const Uint NSTRIPSPART = 48;
 const Uint NSTRIPSCONN = 16;
 const Uint NSTRIPSCHIP = 8;
 
+//The partitions of an RPC are labelled with a letter, from A to Z
+const Uint MAXPARTITIONS = 26;
+
+//The event loops store the strip of the hits inside of their
+//partition on 1 byte, which limits the width of the partitions
+const Uint MAXSTRIPSPART = 256;
+
 //****************************************************************************
 
-typedef struct GIFnBinsMult { Uint rpc[NTROLLEYS][NSLOTS][NPARTITIONS]; } GIFnBinsMult;
-typedef struct GIFH1Array { TH1* rpc[NTROLLEYS][NSLOTS][NPARTITIONS]; } GIFH1Array;
-typedef struct GIFH2Array { TH2* rpc[NTROLLEYS][NSLOTS][NPARTITIONS]; } GIFH2Array;
-typedef struct GIFintArray { int rpc[NTROLLEYS][NSLOTS][NPARTITIONS]; } GIFintArray;
-typedef struct GIFfloatArray { float rpc[NTROLLEYS][NSLOTS][NPARTITIONS]; } GIFfloatArray;
+//Container holding one element per active partition of the
+//infrastructure. The elements are stored contiguously following
+//the dense index of the partitions given by the PartitionTable
+//(trolleys, then slots, then partitions in Dimensions.ini order).
+template <typename X>
+struct PartitionArray {
+    vector<X> rpc;
+
+    PartitionArray() {}
+    PartitionArray(Uint nPartitions, X init = X()) : rpc(nPartitions,init) {}
+    Uint size() const { return rpc.size(); }
+};
+
+typedef PartitionArray<Uint>  GIFnBinsMult;
+typedef PartitionArray<TH1*>  GIFH1Array;
+typedef PartitionArray<TH2*>  GIFH2Array;
+typedef PartitionArray<int>   GIFintArray;
+typedef PartitionArray<float> GIFfloatArray;
 typedef GIFfloatArray muonPeak;
 
+//Time windows of a partition used to sort its hits during the
+//event loop of efficiency runs (muon peak and fake windows)
+typedef struct TimeWindow {
+    float PeakLow;  //Start of the muon peak window
+    float PeakHigh; //End of the muon peak window
+    float FakeLow;  //Start of the fake window (ends with the TDC window)
+} TimeWindow;
+
+typedef PartitionArray<TimeWindow> GIFWindowArray;
+
 typedef enum _QualityFlag {
     GOOD      = 1,
     CORRUPTED = 2
 } QualityFlag;
 
+typedef enum _RunMode {
+    RATE       = 0,
+    EFFICIENCY = 1
+} RunMode;
+
 typedef enum _Efficiency {
     DETECTED = 1,
     MISSED = 0
@@ -84,6 +121,8 @@ const string __mapping = "/ChannelsMapping.csv";
 //Structures to interpret the data inside of the root file
 //->RAWData represents the data structure inside the root
 //  file itself
+//->RAWDataBuffer keeps the content of the RAWData tree
+//  in memory to analyse the file without reading it twice
 //->RPCHit is used to translate the TDC data into physical
 //  data, assigning each hit to a RPC strip
 
@@ -95,4 +134,11 @@ struct RAWData {
     vector<float> *TDCTS;    //List of the corresponding time stamps
 };
 
+struct RAWDataBuffer {
+    vector<Uint>  EntryOffset; //Index of the first hit of each entry (+ total)
+    vector<int>   QFlag;       //Quality flag of each entry
+    vector<Uint>  TDCCh;       //Channels of the hits of all entries
+    vector<float> TDCTS;       //Time stamps of the hits of all entries
+};
+
 #endif
@@ -29,6 +29,9 @@
 
 using namespace std;
 
+//Minimizer used by the fits done by several threads at once
+const string PARALLELMINIMIZER = "Minuit2";
+
 //****************************************************************************
 
 //Functions (more details in utils.cc)
@@ -40,6 +43,7 @@ string  longTostring(long value);
 string  floatTostring(float value);
 
 bool    existFile(string ROOTName);
+Uint    FindDAQFiles(string baseName, vector<string>& files);
 void    WritePath(string basename);
 void    SetTitleName(string rpcID, Uint partition, char* Name,
                      char* Title,string Namebase, string Titlebase);
@@ -50,5 +54,15 @@ float   GetTH1StdDev(TH1* H);
 float   GetChipBin(TH1* H, Uint chip);
 void    SetTH1(TH1* H, string xtitle, string ytitle);
 void    SetTH2(TH2* H, string xtitle, string ytitle, string ztitle);
+void    DeleteHistos(GIFH1Array& H);
+void    DeleteHistos(GIFH2Array& H);
+void    EnableParallelFits(string& minimizer, string& algorithm);
+void    RestoreMinimizer(string minimizer, string algorithm);
+void    SetTreeReading(TTree* dataTree, bool isNewFormat, Uint first, Uint last, Uint cacheMB);
+void    ReadRAWData(TTree* dataTree, bool isNewFormat, RAWDataBuffer& buffer);
+void    ReadRAWFiles(const vector<string>& daqNames, bool isNewFormat, Uint cacheMB,
+                     RAWDataBuffer& buffer);
+unsigned long long GetFileHash(string path);
+void    PrefetchFile(string fileName);
 
 #endif // UTILS_H
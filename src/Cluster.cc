@@ -6,12 +6,11 @@
 // *
 // *    Cluster.cc
 // *
-// *    Class that defines Cluster objects. Clusters are not
-// *    defined as a list of RPCHits but it could one of the
-// *    next updates of the code. For now only saving info
-// *    extracted from the RPCHit list is enough (first and
-// *    lest strips, center, cluster size, time stamps of the
-// *    hits, etc...).
+// *    Building of the clusters of the hits of an event. The
+// *    clusters are not kept as objects : only their size and
+// *    their number are needed to fill the histograms, so they
+// *    are counted while the hits of each partition are grouped
+// *    by time and by adjacent strips.
 // *
 // *    Developped by : Alexis Fagot & Salvador Carillo
 // *    22/06/2017
@@ -19,270 +18,256 @@
 
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include "../include/types.h"
 #include "../include/Cluster.h"
 #include "../include/RPCHit.h"
+#include "../include/MultCounter.h"
+#include "../include/FlatHisto.h"
 
 using namespace std;
 
 // ****************************************************************************************************
-// *    RPCCluster()
+// *    Uint FirstSetBit(const StripWord* mask, Uint from)
+// *    Uint FirstClearBit(const StripWord* mask, Uint from)
 //
-//  Default constructor
+//  Position of the first set (clear) bit of the NWORDS words mask starting from bit from. Returns
+//  NWORDS*64 when there is none.
 // ****************************************************************************************************
 
-RPCCluster::RPCCluster(){
-
+template<Uint NWORDS>
+static inline Uint FirstSetBit(const StripWord* mask, Uint from){
+    for(Uint w = from/64; w < NWORDS; w++){
+        StripWord bits = mask[w];
+        if(w == from/64) bits &= ~0ULL << (from%64);
+        if(bits != 0) return w*64 + __builtin_ctzll(bits);
+    }
+    return NWORDS*64;
 }
 
-// ****************************************************************************************************
-// *    RPCCluster(HitList List, Uint cID, Uint cSize, Uint first, Uint firstID)
-//
-//  Constructor
-// ****************************************************************************************************
-
-RPCCluster::RPCCluster(HitList List, Uint cID, Uint cSize, Uint first, Uint firstID){
-    ClusterID   = cID;
-    ClusterSize = cSize;
-    FirstStrip  = first;
-    LastStrip   = first+cSize-1;
-    Center      = (FirstStrip+LastStrip)/2.;
-
-    //Cluster are reconstructed in the non rejected time window
-    float max = 0.;
-    float min = 0.;
-
-    for(Uint i = firstID; i <= (firstID + cSize-1); i++){
-        if(i == firstID && min == 0. && max == 0.){
-            min = List[i].GetTime();
-            max = List[i].GetTime();
-        } else {
-            if(List[i].GetTime() < min ) min = List[i].GetTime();
-            if(List[i].GetTime() > max ) max = List[i].GetTime();
-        }
+template<Uint NWORDS>
+static inline Uint FirstClearBit(const StripWord* mask, Uint from){
+    for(Uint w = from/64; w < NWORDS; w++){
+        StripWord bits = ~mask[w];
+        if(w == from/64) bits &= ~0ULL << (from%64);
+        if(bits != 0) return w*64 + __builtin_ctzll(bits);
     }
-
-    StartStamp  = min;
-    StopStamp   = max;
-    TimeSpread  = max-min;
+    return NWORDS*64;
 }
 
 // ****************************************************************************************************
-// *    RPCCluster(const RPCCluster &other)
+// *    ClusterBuilder()
 //
-//  Copy constructor
+//  Default constructor
 // ****************************************************************************************************
 
-RPCCluster::RPCCluster(const RPCCluster &other){
-    ClusterID   = other.ClusterID;
-    ClusterSize = other.ClusterSize;
-    FirstStrip  = other.FirstStrip;
-    LastStrip   = other.LastStrip;
-    Center      = other.Center;
-    StartStamp  = other.StartStamp;
-    StopStamp   = other.StopStamp;
-    TimeSpread  = other.TimeSpread;
+ClusterBuilder::ClusterBuilder(){
+
 }
 
 // ****************************************************************************************************
-// *    ~RPCCluster()
+// *    ~ClusterBuilder()
 //
 //  Destructor
 // ****************************************************************************************************
 
-RPCCluster::~RPCCluster(){
+ClusterBuilder::~ClusterBuilder(){
 
 }
 
 // ****************************************************************************************************
-// *    RPCCluster& operator=(const RPCCluster& other)
+// *    void OrderInTime(const HitStore &hits, Uint first, Uint last)
 //
-//  Copy operator
+//  Fills HitIDs with the indices of the hits [first,last[ of the store in time order. The hits of a
+//  TDC come already ordered in time : the range is cut into its time ordered runs that are merged 2
+//  by 2 until a single one is left. When the runs are too short for the merge to be worth it, the
+//  indices are sorted instead.
 // ****************************************************************************************************
 
-RPCCluster& RPCCluster::operator=(const RPCCluster& other){
-    if(this != &other){
-        ClusterID   = other.ClusterID;
-        ClusterSize = other.ClusterSize;
-        FirstStrip  = other.FirstStrip;
-        LastStrip   = other.LastStrip;
-        Center      = other.Center;
-        StartStamp  = other.StartStamp;
-        StopStamp   = other.StopStamp;
-        TimeSpread  = other.TimeSpread;
+void ClusterBuilder::OrderInTime(const HitStore &hits, Uint first, Uint last){
+    Uint nHits = last-first;
+
+    HitIDs.resize(nHits);
+    for(Uint h = 0; h < nHits; h++) HitIDs[h] = first+h;
+
+    //Find the end of each run
+    RunEnds.clear();
+    for(Uint h = 1; h < nHits; h++)
+        if(hits.Time[first+h] < hits.Time[first+h-1]) RunEnds.push_back(h);
+    RunEnds.push_back(nHits);
+
+    //The hits are already in time order
+    if(RunEnds.size() == 1) return;
+
+    //Less than 4 hits per run on average : the hits are not ordered
+    if(4*RunEnds.size() > nHits){
+        sort(HitIDs.begin(), HitIDs.end(), SortStoreByTime(hits));
+        return;
     }
 
-    return *this;
-}
+    Merged.resize(nHits);
+    SortStoreByTime byTime(hits);
 
-// ****************************************************************************************************
-// *    Uint GetID()
-//
-//  Get the private member ClusterID
-// ****************************************************************************************************
+    while(RunEnds.size() > 1){
+        Uint start = 0;
+        Uint nRuns = 0;
 
-Uint RPCCluster::GetID(){
-    return ClusterID;
-}
+        for(Uint r = 0; r < RunEnds.size(); r += 2){
+            Uint middle = RunEnds[r];
+            Uint stop   = (r+1 < RunEnds.size()) ? RunEnds[r+1] : middle;
 
-// ****************************************************************************************************
-// *    Uint GetSize()
-//
-//  Get the private member ClusterSize
-// ****************************************************************************************************
+            merge(HitIDs.begin()+start, HitIDs.begin()+middle,
+                  HitIDs.begin()+middle, HitIDs.begin()+stop,
+                  Merged.begin()+start, byTime);
 
-Uint RPCCluster::GetSize(){
-    return ClusterSize;
+            RunEnds[nRuns++] = stop;
+            start = stop;
+        }
+
+        RunEnds.resize(nRuns);
+        HitIDs.swap(Merged);
+    }
 }
 
 // ****************************************************************************************************
-// *    Uint GetFirstStrip()
+// *    Uint BuildGroup<NWORDS>(const HitStore &hits, Uint* hitIDs, Uint nHits, FlatH1 &hcSize)
 //
-//  Get the private member FirstStrip
+//  Groups the adjacent strips of the nHits hits of a time group, fills the size of each cluster into
+//  hcSize and returns the number of clusters. The strips of the group are set into an occupancy mask
+//  whose runs of set bits, i.e. the clusters, are extracted with count-trailing-zeros. The size of a
+//  cluster is its number of hits, counting twice a strip hit twice. Every cluster after the first one
+//  of the group gets one more hit, as the cluster sizes were always counted this way.
 // ****************************************************************************************************
 
-Uint RPCCluster::GetFirstStrip(){
-    return FirstStrip;
-}
+template<Uint NWORDS>
+Uint ClusterBuilder::BuildGroup(const HitStore &hits, Uint* hitIDs, Uint nHits, FlatH1 &hcSize){
+    if(nHits == 0) return 0;
 
-// ****************************************************************************************************
-// *    Uint GetLastStrip()
-//
-//  Get the private member LastStrip
-// ****************************************************************************************************
+    StripWord mask[NWORDS] = {0};
+    Doubles.clear();
 
-Uint RPCCluster::GetLastStrip(){
-    return LastStrip;
-}
+    for(Uint i = 0; i < nHits; i++){
+        Uint      s   = hits.Strip[hitIDs[i]];
+        StripWord bit = 1ULL << (s%64);
 
-// ****************************************************************************************************
-// *    float GetCenter()
-//
-//  Get the private member Center
-// ****************************************************************************************************
+        if(mask[s/64] & bit) Doubles.push_back(s);
+        else mask[s/64] |= bit;
+    }
 
-float RPCCluster::GetCenter(){
-    return Center;
-}
+    Uint nClusters = 0;
+    Uint start     = FirstSetBit<NWORDS>(mask,0);
 
-// ****************************************************************************************************
-// *    float GetStart()
-//
-//  Get the private member StartStamp
-// ****************************************************************************************************
+    while(start < NWORDS*64){
+        //The cluster covers the strips [start,stop[
+        Uint stop  = FirstClearBit<NWORDS>(mask,start);
+        Uint cSize = stop-start;
 
-float RPCCluster::GetStart(){
-    return StartStamp;
-}
+        for(Uint d = 0; d < Doubles.size(); d++)
+            if(Doubles[d] >= start && Doubles[d] < stop) cSize++;
 
-// ****************************************************************************************************
-// *    float GetStop()
-//
-//  Get the private member StopStamp
-// ****************************************************************************************************
+        if(nClusters > 0) cSize++;
 
-float RPCCluster::GetStop(){
-    return StopStamp;
-}
+        hcSize.Fill(cSize);
+        nClusters++;
 
-// ****************************************************************************************************
-// *    float GetSpread()
-//
-//  Get the private member TimeSpread
-// ****************************************************************************************************
+        start = FirstSetBit<NWORDS>(mask,stop);
+    }
 
-float RPCCluster::GetSpread(){
-    return TimeSpread;
+    return nClusters;
 }
 
 // ****************************************************************************************************
-// *    void BuildClusters(HitList &cluster, ClusterList &clusterList)
+// *    Uint BuildGroup<0>(const HitStore &hits, Uint* hitIDs, Uint nHits, FlatH1 &hcSize)
 //
-//  Build cluster using the sorted RPC hit arrays
-//  We need the following variables:
-//  - cluster size
-//  - isolation (nominal, "other side")
-//  - cluster:
-//      * center,  (left, right sides)
-//      * delta time
+//  Same as above for the partitions too wide for the occupancy mask : sorts the hits by strip order
+//  and makes clusters using adjacent strips.
 // ****************************************************************************************************
 
-void BuildClusters(HitList &cluster, ClusterList &clusterList){
-    if(cluster.size() > 0){
-        // Sort by strip order to make cluster by using adjacent strips
-        sort(cluster.begin(), cluster.end(), SortHitbyStrip);
-
-        Uint firstHit = cluster.front().GetStrip(); //first cluster hit
-        Uint previous = firstHit;              //previous strip checked
-        Uint hitID = 0;      //ID of the first cluster hit to
-                             //look for start and stop stamps
-        Uint clusterID = 0;  //ID of the cluster starting from 0
-        Uint cSize = 0;      //cluster size counter
-
-        //Loop over the hit list and group adjacent strips
-        for(Uint i = 0; i < cluster.size(); i++){
-            if (cluster[i].GetStrip()-previous > 1){
-                clusterList.push_back(RPCCluster(cluster,clusterID,cSize,firstHit,hitID));
-
-                cSize = 1;
-                hitID = i;
-                firstHit = cluster[i].GetStrip();
-                clusterID++;
-            }
-            previous = cluster[i].GetStrip();
-            cSize++;
-        }
-        clusterID++;
+template<>
+Uint ClusterBuilder::BuildGroup<0>(const HitStore &hits, Uint* hitIDs, Uint nHits, FlatH1 &hcSize){
+    if(nHits == 0) return 0;
+
+    // Sort by strip order to make cluster by using adjacent strips
+    sort(hitIDs, hitIDs+nHits, SortStoreByStrip(hits));
 
-        //Add the last cluster to the list
-        clusterList.push_back(RPCCluster(cluster,clusterID,cSize,firstHit,hitID));
+    Uint previous = hits.Strip[hitIDs[0]]; //previous strip checked
+    Uint nClusters = 0;                    //number of clusters of the group
+    Uint cSize = 0;                        //cluster size counter
+
+    for(Uint i = 0; i < nHits; i++){
+        Uint strip = hits.Strip[hitIDs[i]];
+
+        if(strip-previous > 1){
+            hcSize.Fill(cSize);
+            nClusters++;
+            cSize = 1;
+        }
+        previous = strip;
+        cSize++;
     }
+
+    //Last cluster of the group
+    hcSize.Fill(cSize);
+    nClusters++;
+
+    return nClusters;
 }
 
 // ****************************************************************************************************
-// *   void Clusterization(HitList &hits, TH1 *hcSize, TH1 *hcMult)
+// *    void ClusterizeGroups<NWORDS>(const HitStore &hits, Uint first, Uint last,
+// *                                  FlatH1 &hcSize, MultCounter &hcMult)
 //
-//  Used to loop over the hit list, create clusters and fill histograms. Calls BuildClusters.
+//  Orders the indices of the hits [first,last[ of the store in time, splits them into groups of hits
+//  closer than 25 ns from each other and builds the clusters of each group. Fills the cluster sizes
+//  into hcSize and the number of clusters into hcMult.
 // ****************************************************************************************************
 
-void Clusterization(HitList &hits, TH1 *hcSize, TH1 *hcMult){
-    HitList cluster;
-    cluster.clear();
+template<Uint NWORDS>
+void ClusterBuilder::ClusterizeGroups(const HitStore &hits, Uint first, Uint last,
+                                      FlatH1 &hcSize, MultCounter &hcMult){
+    Uint nHits = last-first;
 
-    ClusterList clusterList;
-    clusterList.clear();
+    OrderInTime(hits,first,last);
 
-    float timediff = 0.;
-    float lastime = 0.;
+    Uint  nClusters  = 0;
+    Uint  groupStart = 0;
+    float lastime    = 0.;
 
-    for(Uint h = 0; h < hits.size(); h ++){
-        timediff = hits[h].GetTime()-lastime;
+    for(Uint h = 0; h < nHits; h++){
+        float time = hits.Time[HitIDs[h]];
 
         //If there is 25 time difference with the previous hit
         //consider that the hit is too far in time and make
-        //cluster with what has been saved into the cluster
-        //vector
-        if(abs(timediff) > 25. && lastime > 0.){
-            BuildClusters(cluster,clusterList);
-            cluster.clear();
+        //cluster with the hits of the group started before
+        if(abs(time-lastime) > 25. && lastime > 0.){
+            nClusters += BuildGroup<NWORDS>(hits,HitIDs.data()+groupStart,h-groupStart,hcSize);
+            groupStart = h;
         }
 
-        lastime = hits[h].GetTime();
-        cluster.push_back(hits[h]);
+        lastime = time;
     }
 
-    //Make cluster with the very last part of data saved in the list
-    if(cluster.size() > 0){
-        BuildClusters(cluster,clusterList);
-        cluster.clear();
-    }
+    //Make cluster with the very last group
+    nClusters += BuildGroup<NWORDS>(hits,HitIDs.data()+groupStart,nHits-groupStart,hcSize);
+
+    hcMult.Fill(nClusters);
+}
 
-    //First correct the multiplicity
-    hcMult->Fill(clusterList.size());
+// ****************************************************************************************************
+// *    void Clusterize(const HitStore &hits, Uint first, Uint last, Uint nStrips,
+// *                    FlatH1 &hcSize, MultCounter &hcMult)
+//
+//  Clusterizes the hits [first,last[ of a partition of nStrips strips, numbered from 0 in the store,
+//  using the kernel fitting the partition width.
+// ****************************************************************************************************
 
-    //Then get the global cluster size of the reconstructed cluster list
-    for(Uint i = 0; i < clusterList.size(); i++)
-        if(clusterList[i].GetSize() > 0)
-            hcSize->Fill(clusterList[i].GetSize());
+void ClusterBuilder::Clusterize(const HitStore &hits, Uint first, Uint last, Uint nStrips,
+                                FlatH1 &hcSize, MultCounter &hcMult){
+    if(nStrips <= 64)
+        ClusterizeGroups<1>(hits,first,last,hcSize,hcMult);
+    else if(nStrips <= 128)
+        ClusterizeGroups<2>(hits,first,last,hcSize,hcMult);
+    else
+        ClusterizeGroups<0>(hits,first,last,hcSize,hcMult);
 }
@@ -26,7 +26,34 @@
 
 using namespace std;
 
+// ****************************************************************************************************
+// *    void GetCurrent(string baseName)
+//
+//  Extracts the currents of baseName_CAEN.root using the geometry of the scan directory.
+// ****************************************************************************************************
+
 void GetCurrent(string baseName){
+    //Get the chamber geometry
+    string dimpath = baseName.substr(0,baseName.find_last_of("/")) + "/Dimensions.ini";
+    IniFile* Dimensions = new IniFile(dimpath.c_str());
+    Dimensions->Read();
+
+    Infrastructure* Infra = new Infrastructure(Dimensions);
+
+    GetCurrent(baseName,Infra);
+
+    delete Infra;
+    delete Dimensions;
+}
+
+// ****************************************************************************************************
+// *    void GetCurrent(string baseName, Infrastructure* Infra)
+//
+//  Same as above with the geometry Infra of the scan already loaded. The currents are appended to
+//  the Offline-Current.csv file of the scan.
+// ****************************************************************************************************
+
+void GetCurrent(string baseName, Infrastructure* Infra){
 
     string caenName = baseName + "_CAEN.root";
 
@@ -44,16 +71,6 @@ void GetCurrent(string baseName){
 
     if(caenFile.IsOpen()){
 
-        //****************** GEOMETRY ************************************
-
-        //Get the chamber geometry
-        string dimpath = caenName.substr(0,caenName.find_last_of("/")) + "/Dimensions.ini";
-        IniFile* Dimensions = new IniFile(dimpath.c_str());
-        Dimensions->Read();
-
-        Infrastructure* Infra = new Infrastructure(Dimensions);
-
-
         //****************** OUPUT FILE **********************************
 
         //output csv file
@@ -0,0 +1,113 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    DecodeTable.cc
+// *
+// *    Class that defines DecodeTable objects. They are built
+// *    once from the Mapping and the PartitionTable and give
+// *    for each TDC channel the trolley, slot, partition and
+// *    strip it is connected to, so that the event loops don't
+// *    need to look into the infrastructure for every hit.
+//***************************************************************
+
+#include <vector>
+
+#include "../include/DecodeTable.h"
+#include "../include/Mapping.h"
+#include "../include/PartitionTable.h"
+#include "../include/MsgSvc.h"
+#include "../include/types.h"
+
+using namespace std;
+
+// ****************************************************************************************************
+// *    DecodeTable()
+//
+//  Default constructor. The table only contains the empty code.
+// ****************************************************************************************************
+
+DecodeTable::DecodeTable(){
+    ChannelCode empty = {0,0,0,0,0};
+
+    LastChannel = 0;
+    nPartitions = 0;
+    Table.assign(1,empty);
+}
+
+// ****************************************************************************************************
+// *    DecodeTable(Mapping* RPCChMap, PartitionTable* Parts)
+//
+//  Constructor. Decodes every TDC channel of the mapping and gives it the dense index of its partition
+//  in the partition table. The channels of RPCs whose partitions are wider than MAXSTRIPSPART strips
+//  can't be stored by the event loops and stay unlinked.
+// ****************************************************************************************************
+
+DecodeTable::DecodeTable(Mapping* RPCChMap, PartitionTable* Parts){
+    nPartitions = Parts->GetNPartitions();
+
+    ChannelCode empty = {0,0,0,0,0};
+
+    LastChannel = RPCChMap->GetTableSize();
+    Table.assign(LastChannel+1,empty);
+
+    //RPCs already reported as too wide
+    vector<bool> tooWide(nPartitions,false);
+
+    for(Uint ch = 0; ch < LastChannel; ch++){
+        Uint rpcchannel = RPCChMap->Decode(ch);
+
+        if(rpcchannel == NOCHANNELLINK) continue;
+
+        Uint T = rpcchannel/10000;        //Trolley (1st digit of the RPC channel)
+        Uint S = (rpcchannel%10000)/1000; //Slot (2nd digit)
+        Uint strip = rpcchannel%1000;     //Strip (3 last digits)
+
+        //Channels of RPCs that are not in the infrastructure or
+        //beyond the last partition of their RPC stay unlinked
+        Uint first = Parts->FindFirst(T,S);
+        if(first == NOPARTITION || strip == 0) continue;
+
+        const PartitionInfo& rpc = Parts->GetInfo(first);
+        if(rpc.nStrips == 0) continue;
+
+        if(rpc.nStrips > MAXSTRIPSPART){
+            if(!tooWide[first])
+                MSG_ERROR("[Offline] Partitions of " + rpc.RPCName + " have more than "
+                          + to_string(MAXSTRIPSPART) + " strips, its channels are ignored");
+            tooWide[first] = true;
+            continue;
+        }
+
+        Uint P = (strip-1)/rpc.nStrips+1;
+        if(first+P-1 >= Parts->GetLast(rpc.RPC)) continue;
+
+        Table[ch].Trolley = T;
+        Table[ch].Slot = S;
+        Table[ch].Partition = P;
+        Table[ch].Strip = strip;
+        Table[ch].Index = first + P-1;
+    }
+}
+
+// ****************************************************************************************************
+// *    ~DecodeTable()
+//
+//  Destructor
+// ****************************************************************************************************
+
+DecodeTable::~DecodeTable(){
+
+}
+
+// ****************************************************************************************************
+// *    Uint GetNPartitions()
+//
+//  Get the private member nPartitions, the number of active partitions of the infrastructure
+// ****************************************************************************************************
+
+Uint DecodeTable::GetNPartitions(){
+    return nPartitions;
+}
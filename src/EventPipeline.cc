@@ -0,0 +1,267 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    EventPipeline.cc
+// *
+// *    Reading stage of the pipelined loop over the entries.
+// *    A single reader thread reads, decompresses and unpacks
+// *    the entries of the RAWData tree ahead into chunks of
+// *    compact event records. The chunks are handed over to the
+// *    analysis threads through bounded lock-free rings (one
+// *    producer, one consumer each) whose slots keep their
+// *    memory from one chunk to the next. A thread finding its
+// *    ring full or empty retries a few times and then sleeps
+// *    until the other side moves.
+//***************************************************************
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "TTree.h"
+
+#include "../include/EventPipeline.h"
+#include "../include/types.h"
+
+using namespace std;
+
+// ****************************************************************************************************
+// *    ChunkRing(Uint depth)
+//
+//  Constructor. The ring can hold depth chunks waiting to be analysed.
+// ****************************************************************************************************
+
+ChunkRing::ChunkRing(Uint depth) : Slots(depth > 0 ? depth : 1), Head(0), Tail(0), Closed(false),
+                                   nAsleep(0){
+
+}
+
+// ****************************************************************************************************
+// *    ~ChunkRing()
+//
+//  Destructor
+// ****************************************************************************************************
+
+ChunkRing::~ChunkRing(){
+
+}
+
+// ****************************************************************************************************
+// *    RAWDataBuffer* GetWriteSlot()
+//
+//  Producer side. Returns the slot to fill with the next chunk or NULL if the ring is full. The
+//  chunk is only given to the consumer by Push().
+// ****************************************************************************************************
+
+RAWDataBuffer* ChunkRing::GetWriteSlot(){
+    Uint tail = Tail.load(memory_order_relaxed);
+
+    if(tail - Head.load(memory_order_acquire) == Slots.size()) return NULL;
+
+    return &Slots[tail % Slots.size()];
+}
+
+// ****************************************************************************************************
+// *    RAWDataBuffer* WaitWriteSlot()
+//
+//  Producer side. Same as GetWriteSlot() but waits for the consumer to free a slot when the ring is
+//  full : the ring is looked at again PIPESPIN times and the producer then sleeps until Pop().
+// ****************************************************************************************************
+
+RAWDataBuffer* ChunkRing::WaitWriteSlot(){
+    RAWDataBuffer* slot = GetWriteSlot();
+
+    for(Uint s = 0; slot == NULL && s < PIPESPIN; s++){
+        this_thread::yield();
+        slot = GetWriteSlot();
+    }
+
+    if(slot == NULL){
+        //The sleeper is counted before looking at the ring a last time
+        //so that a Pop() in between can't miss it
+        nAsleep.fetch_add(1);
+
+        unique_lock<mutex> lock(Lock);
+        Changed.wait(lock,[&](){ return (slot = GetWriteSlot()) != NULL; });
+
+        nAsleep.fetch_sub(1);
+    }
+
+    return slot;
+}
+
+// ****************************************************************************************************
+// *    void Push()
+//
+//  Producer side. Gives the chunk filled in the slot returned by GetWriteSlot() to the consumer.
+// ****************************************************************************************************
+
+void ChunkRing::Push(){
+    Tail.store(Tail.load(memory_order_relaxed)+1, memory_order_release);
+    Wake();
+}
+
+// ****************************************************************************************************
+// *    RAWDataBuffer* GetReadSlot()
+//
+//  Consumer side. Returns the oldest chunk given by the producer or NULL if the ring is empty. The
+//  slot stays to the consumer until Pop().
+// ****************************************************************************************************
+
+RAWDataBuffer* ChunkRing::GetReadSlot(){
+    Uint head = Head.load(memory_order_relaxed);
+
+    if(head == Tail.load(memory_order_acquire)) return NULL;
+
+    return &Slots[head % Slots.size()];
+}
+
+// ****************************************************************************************************
+// *    RAWDataBuffer* WaitReadSlot()
+//
+//  Consumer side. Same as GetReadSlot() but waits for the producer to give a chunk when the ring is
+//  empty : the ring is looked at again PIPESPIN times and the consumer then sleeps until Push() or
+//  Close(). Returns NULL once the ring is closed and empty.
+// ****************************************************************************************************
+
+RAWDataBuffer* ChunkRing::WaitReadSlot(){
+    //The ring has to be seen closed before being seen empty to
+    //be sure that the producer won't give any other chunk
+    bool closed = IsClosed();
+    RAWDataBuffer* slot = GetReadSlot();
+
+    for(Uint s = 0; slot == NULL && !closed && s < PIPESPIN; s++){
+        this_thread::yield();
+        closed = IsClosed();
+        slot = GetReadSlot();
+    }
+
+    if(slot == NULL && !closed){
+        nAsleep.fetch_add(1);
+
+        unique_lock<mutex> lock(Lock);
+        Changed.wait(lock,[&](){
+            closed = IsClosed();
+            slot = GetReadSlot();
+            return slot != NULL || closed;
+        });
+
+        nAsleep.fetch_sub(1);
+    }
+
+    return slot;
+}
+
+// ****************************************************************************************************
+// *    void Pop()
+//
+//  Consumer side. Gives the slot of the chunk returned by GetReadSlot() back to the producer.
+// ****************************************************************************************************
+
+void ChunkRing::Pop(){
+    Head.store(Head.load(memory_order_relaxed)+1, memory_order_release);
+    Wake();
+}
+
+// ****************************************************************************************************
+// *    void Close()
+// *    bool IsClosed()
+//
+//  The producer closes the ring after its last Push(). Once the consumer sees the ring closed, the
+//  chunks still in the ring are the last ones.
+// ****************************************************************************************************
+
+void ChunkRing::Close(){
+    Closed.store(true, memory_order_release);
+    Wake();
+}
+
+bool ChunkRing::IsClosed() const{
+    return Closed.load(memory_order_acquire);
+}
+
+// ****************************************************************************************************
+// *    void Wake()
+//
+//  Wakes up the other side of the ring if it is sleeping. The lock is only taken when a thread
+//  sleeps, so that the slots are still handed over without lock while both sides keep up. The
+//  fence orders the update of the ring before the count of the sleepers, as the sleepers count
+//  themselves before looking at the ring.
+// ****************************************************************************************************
+
+void ChunkRing::Wake(){
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if(nAsleep.load() == 0) return;
+
+    lock_guard<mutex> lock(Lock);
+    Changed.notify_all();
+}
+
+// ****************************************************************************************************
+// *    void ReadChunks(TTree* dataTree, Uint first, Uint last, bool isNewFormat,
+// *                    vector<ChunkRing*>& Rings)
+//
+//  Producer of the pipelined loop. Reads the entries [first,last[ of the RAWData tree into chunks
+//  of PIPECHUNK entries and gives the chunks to the rings in turn, so that the entries analysed by
+//  each thread don't depend on the thread scheduling. When the next ring is full, the reader waits
+//  for its analysis thread. All the rings are closed at the end.
+// ****************************************************************************************************
+
+void ReadChunks(TTree* dataTree, Uint first, Uint last, bool isNewFormat,
+                vector<ChunkRing*>& Rings){
+    RAWData data;
+
+    data.QFlag = GOOD;
+    data.TDCCh = new vector<Uint>;
+    data.TDCTS = new vector<float>;
+    data.TDCCh->clear();
+    data.TDCTS->clear();
+
+    dataTree->SetBranchAddress("TDC_channel",    &data.TDCCh);
+    dataTree->SetBranchAddress("TDC_TimeStamp",  &data.TDCTS);
+
+    if(isNewFormat)
+        dataTree->SetBranchAddress("Quality_flag", &data.QFlag);
+
+    Uint nRings = Rings.size();
+    Uint r = 0;
+    Uint i = first;
+
+    while(i < last){
+        //Wait for a free slot in the next ring
+        RAWDataBuffer* chunk = Rings[r]->WaitWriteSlot();
+
+        chunk->EntryOffset.clear();
+        chunk->QFlag.clear();
+        chunk->TDCCh.clear();
+        chunk->TDCTS.clear();
+
+        Uint end = (last-i > PIPECHUNK) ? i+PIPECHUNK : last;
+
+        for(; i < end; i++){
+            dataTree->GetEntry(i);
+
+            chunk->EntryOffset.push_back(chunk->TDCCh.size());
+            chunk->QFlag.push_back(data.QFlag);
+            chunk->TDCCh.insert(chunk->TDCCh.end(),data.TDCCh->begin(),data.TDCCh->end());
+            chunk->TDCTS.insert(chunk->TDCTS.end(),data.TDCTS->begin(),data.TDCTS->end());
+        }
+        chunk->EntryOffset.push_back(chunk->TDCCh.size());
+
+        Rings[r]->Push();
+        r = (r+1) % nRings;
+    }
+
+    for(Uint w = 0; w < nRings; w++)
+        Rings[w]->Close();
+
+    dataTree->ResetBranchAddresses();
+    delete data.TDCCh;
+    delete data.TDCTS;
+}
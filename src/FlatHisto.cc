@@ -0,0 +1,350 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    FlatHisto.cc
+// *
+// *    Classes that define FlatH1 and FlatH2 objects. These
+// *    are fixed binning accumulators filled in the loop over
+// *    the entries in place of ROOT histograms : the bin is
+// *    computed directly (or given by the caller for strips)
+// *    and the contents are plain integer arrays, allocated
+// *    the first time the accumulator is filled. The ROOT
+// *    histogram is only booked once the loop is over, with
+// *    the same entries and statistics as if it had been
+// *    filled.
+//***************************************************************
+
+#include <vector>
+#include <iostream>
+
+#include "TH1F.h"
+#include "TH1I.h"
+#include "TH2F.h"
+
+#include "../include/FlatHisto.h"
+#include "../include/types.h"
+
+using namespace std;
+
+// ****************************************************************************************************
+// *    FlatH1()
+//
+//  Default constructor
+// ****************************************************************************************************
+
+FlatH1::FlatH1(){
+    Axis.nBins = 0;
+    Axis.Low   = 0.;
+    Axis.High  = 0.;
+    Reset();
+}
+
+// ****************************************************************************************************
+// *    ~FlatH1()
+//
+//  Destructor
+// ****************************************************************************************************
+
+FlatH1::~FlatH1(){
+
+}
+
+// ****************************************************************************************************
+// *    void SetBinning(int nbins, double low, double high)
+//
+//  Sets the binning of the accumulator (as for a TH1 booked with nbins, low, high) and empties it.
+// ****************************************************************************************************
+
+void FlatH1::SetBinning(int nbins, double low, double high){
+    Axis.nBins = nbins;
+    Axis.Low   = low;
+    Axis.High  = high;
+    Reset();
+}
+
+// ****************************************************************************************************
+// *    void Reset()
+//
+//  Empties the accumulator keeping its binning. The memory of the contents is released.
+// ****************************************************************************************************
+
+void FlatH1::Reset(){
+    vector<Uint>().swap(Content);
+    Entries = 0.;
+    SumW    = 0.;
+    SumWX   = 0.;
+    SumWX2  = 0.;
+}
+
+// ****************************************************************************************************
+// *    void Add(const FlatH1& other)
+//
+//  Adds the content of accumulator other, that has the same binning, to this one.
+// ****************************************************************************************************
+
+void FlatH1::Add(const FlatH1& other){
+    if(Content.empty())
+        Content = other.Content;
+    else if(!other.Content.empty())
+        for(Uint b = 0; b < Content.size(); b++)
+            Content[b] += other.Content[b];
+
+    Entries += other.Entries;
+    SumW    += other.SumW;
+    SumWX   += other.SumWX;
+    SumWX2  += other.SumWX2;
+}
+
+// ****************************************************************************************************
+// *    void CopyTo(TH1* H)
+//
+//  Sets the contents, the statistics and the number of entries of the empty histogram H, booked
+//  with the same binning, to the ones of the accumulator.
+// ****************************************************************************************************
+
+void FlatH1::CopyTo(TH1* H) const{
+    if(Entries == 0.) return;
+
+    for(Uint b = 0; b < Content.size(); b++)
+        if(Content[b] > 0) H->SetBinContent(b,Content[b]);
+
+    //The weights are all 1 : sum of weights = sum of squared weights
+    double stats[4] = {SumW, SumW, SumWX, SumWX2};
+    H->PutStats(stats);
+    H->SetEntries(Entries);
+}
+
+// ****************************************************************************************************
+// *    TH1* MakeTH1F(const char* name, const char* title)
+// *    TH1* MakeTH1I(const char* name, const char* title)
+//
+//  Books a TH1F (TH1I) with the binning of the accumulator and copies the accumulator into it.
+// ****************************************************************************************************
+
+TH1* FlatH1::MakeTH1F(const char* name, const char* title) const{
+    TH1* H = new TH1F(name, title, Axis.nBins, Axis.Low, Axis.High);
+    CopyTo(H);
+
+    return H;
+}
+
+TH1* FlatH1::MakeTH1I(const char* name, const char* title) const{
+    TH1* H = new TH1I(name, title, Axis.nBins, Axis.Low, Axis.High);
+    CopyTo(H);
+
+    return H;
+}
+
+// ****************************************************************************************************
+// *    FlatH2()
+//
+//  Default constructor
+// ****************************************************************************************************
+
+FlatH2::FlatH2(){
+    X.nBins = 0;
+    X.Low   = 0.;
+    X.High  = 0.;
+    Y = X;
+    Reset();
+}
+
+// ****************************************************************************************************
+// *    ~FlatH2()
+//
+//  Destructor
+// ****************************************************************************************************
+
+FlatH2::~FlatH2(){
+
+}
+
+// ****************************************************************************************************
+// *    void SetBinning(int nbinsx, double xlow, double xhigh, int nbinsy, double ylow, double yhigh)
+//
+//  Sets the binning of the accumulator (as for a TH2 booked with the same arguments) and empties it.
+// ****************************************************************************************************
+
+void FlatH2::SetBinning(int nbinsx, double xlow, double xhigh,
+                        int nbinsy, double ylow, double yhigh){
+    X.nBins = nbinsx;
+    X.Low   = xlow;
+    X.High  = xhigh;
+    Y.nBins = nbinsy;
+    Y.Low   = ylow;
+    Y.High  = yhigh;
+    Reset();
+}
+
+// ****************************************************************************************************
+// *    void Reset()
+//
+//  Empties the accumulator keeping its binning. The memory of the contents is released.
+// ****************************************************************************************************
+
+void FlatH2::Reset(){
+    vector<Uint>().swap(Content);
+    Entries = 0.;
+    SumW    = 0.;
+    SumWX   = 0.;
+    SumWX2  = 0.;
+    SumWY   = 0.;
+    SumWY2  = 0.;
+    SumWXY  = 0.;
+}
+
+// ****************************************************************************************************
+// *    void Add(const FlatH2& other)
+//
+//  Adds the content of accumulator other, that has the same binning, to this one.
+// ****************************************************************************************************
+
+void FlatH2::Add(const FlatH2& other){
+    if(Content.empty())
+        Content = other.Content;
+    else if(!other.Content.empty())
+        for(Uint b = 0; b < Content.size(); b++)
+            Content[b] += other.Content[b];
+
+    Entries += other.Entries;
+    SumW    += other.SumW;
+    SumWX   += other.SumWX;
+    SumWX2  += other.SumWX2;
+    SumWY   += other.SumWY;
+    SumWY2  += other.SumWY2;
+    SumWXY  += other.SumWXY;
+}
+
+// ****************************************************************************************************
+// *    void CopyTo(TH2* H)
+//
+//  Sets the contents, the statistics and the number of entries of the empty histogram H, booked
+//  with the same binning, to the ones of the accumulator.
+// ****************************************************************************************************
+
+void FlatH2::CopyTo(TH2* H) const{
+    if(Entries == 0.) return;
+
+    for(Uint b = 0; b < Content.size(); b++)
+        if(Content[b] > 0) H->SetBinContent(b,Content[b]);
+
+    //The weights are all 1 : sum of weights = sum of squared weights
+    double stats[7] = {SumW, SumW, SumWX, SumWX2, SumWY, SumWY2, SumWXY};
+    H->PutStats(stats);
+    H->SetEntries(Entries);
+}
+
+// ****************************************************************************************************
+// *    TH2* MakeTH2F(const char* name, const char* title)
+//
+//  Books a TH2F with the binning of the accumulator and copies the accumulator into it.
+// ****************************************************************************************************
+
+TH2* FlatH2::MakeTH2F(const char* name, const char* title) const{
+    TH2* H = new TH2F(name, title, X.nBins, X.Low, X.High, Y.nBins, Y.Low, Y.High);
+    CopyTo(H);
+
+    return H;
+}
+
+// ****************************************************************************************************
+// *    void SaveAxis(ostream& out, const FlatAxis& axis)
+// *    bool LoadAxis(istream& in, FlatAxis& axis)
+// *    bool LoadContent(istream& in, vector<Uint>& content, Uint nBins)
+//
+//  Binary writing and reading of the binning and of the bin contents of the accumulators. The
+//  contents are preceded by their size, 0 when nothing was filled yet. The accumulators that were
+//  never given a binning (the muon families of rate runs) have an axis of 0 bins.
+// ****************************************************************************************************
+
+static void SaveAxis(ostream& out, const FlatAxis& axis){
+    out.write((const char*)&axis.nBins,sizeof(axis.nBins));
+    out.write((const char*)&axis.Low,sizeof(axis.Low));
+    out.write((const char*)&axis.High,sizeof(axis.High));
+}
+
+static bool LoadAxis(istream& in, FlatAxis& axis){
+    in.read((char*)&axis.nBins,sizeof(axis.nBins));
+    in.read((char*)&axis.Low,sizeof(axis.Low));
+    in.read((char*)&axis.High,sizeof(axis.High));
+
+    return !in.fail();
+}
+
+static void SaveContent(ostream& out, const vector<Uint>& content){
+    Uint size = content.size();
+
+    out.write((const char*)&size,sizeof(size));
+    out.write((const char*)content.data(),size*sizeof(Uint));
+}
+
+static bool LoadContent(istream& in, vector<Uint>& content, Uint nBins){
+    Uint size = 0;
+
+    in.read((char*)&size,sizeof(size));
+    if(in.fail() || (size != 0 && size != nBins)) return false;
+
+    content.assign(size,0);
+    in.read((char*)content.data(),size*sizeof(Uint));
+
+    return !in.fail();
+}
+
+// ****************************************************************************************************
+// *    void Save(ostream& out)
+// *    bool Load(istream& in)
+//
+//  Writes the accumulator into the binary stream out / Replaces the accumulator by the one read
+//  from in. Load returns false if the stream doesn't contain a valid accumulator.
+// ****************************************************************************************************
+
+void FlatH1::Save(ostream& out) const{
+    double stats[4] = {Entries, SumW, SumWX, SumWX2};
+
+    SaveAxis(out,Axis);
+    out.write((const char*)stats,sizeof(stats));
+    SaveContent(out,Content);
+}
+
+bool FlatH1::Load(istream& in){
+    double stats[4];
+
+    if(!LoadAxis(in,Axis)) return false;
+
+    in.read((char*)stats,sizeof(stats));
+    Entries = stats[0];
+    SumW    = stats[1];
+    SumWX   = stats[2];
+    SumWX2  = stats[3];
+
+    return LoadContent(in,Content,Axis.nBins+2);
+}
+
+void FlatH2::Save(ostream& out) const{
+    double stats[7] = {Entries, SumW, SumWX, SumWX2, SumWY, SumWY2, SumWXY};
+
+    SaveAxis(out,X);
+    SaveAxis(out,Y);
+    out.write((const char*)stats,sizeof(stats));
+    SaveContent(out,Content);
+}
+
+bool FlatH2::Load(istream& in){
+    double stats[7];
+
+    if(!LoadAxis(in,X) || !LoadAxis(in,Y)) return false;
+
+    in.read((char*)stats,sizeof(stats));
+    Entries = stats[0];
+    SumW    = stats[1];
+    SumWX   = stats[2];
+    SumWX2  = stats[3];
+    SumWY   = stats[4];
+    SumWY2  = stats[5];
+    SumWXY  = stats[6];
+
+    return LoadContent(in,Content,(X.nBins+2)*(Y.nBins+2));
+}
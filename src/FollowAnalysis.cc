@@ -0,0 +1,266 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    FollowAnalysis.cc
+// *
+// *    Online analysis of a DAQ file while it is still being
+// *    written. The RAWData tree is refreshed periodically and
+// *    only the new entries are looped over, the loop histograms
+// *    being kept in memory. Snapshots of the results are
+// *    published at regular intervals and the final results are
+// *    written as by the offline analysis once the run is over.
+//***************************************************************
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <unistd.h>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TString.h"
+#include "TH1.h"
+
+#include "../include/FollowAnalysis.h"
+#include "../include/RPCHit.h"
+#include "../include/MsgSvc.h"
+#include "../include/types.h"
+#include "../include/utils.h"
+
+using namespace std;
+
+// ****************************************************************************************************
+// *    bool StartFollowing(string daqName, TFile*& dataFile, TTree*& dataTree, LoopResults& R,
+// *                        PartitionTable* Parts)
+//
+//  Tries to open the DAQ file daqName being written and to get its RAWData and RunParameters trees.
+//  On success, dataFile and dataTree are set, the run type and format are saved into R and the loop
+//  histograms are initialised. Returns false, leaving dataFile and dataTree to NULL, if the file or
+//  its trees are not written yet.
+// ****************************************************************************************************
+
+static bool StartFollowing(string daqName, TFile*& dataFile, TTree*& dataTree, LoopResults& R,
+                           PartitionTable* Parts){
+    if(dataFile == NULL){
+        dataFile = new TFile(daqName.c_str());
+
+        if(!dataFile->IsOpen() || dataFile->IsZombie()){
+            delete dataFile;
+            dataFile = NULL;
+            return false;
+        }
+    }
+
+    //Look for the trees saved since the last try
+    dataFile->ReadKeys();
+
+    TTree* RunParameters = (TTree*)dataFile->Get("RunParameters");
+    TTree* RAWTree = (TTree*)dataFile->Get("RAWData");
+
+    if(RunParameters == NULL || RAWTree == NULL) return false;
+
+    //Convention : ON = beam trigger , OFF = Random trigger
+    TString* RunType = new TString();
+    RunParameters->SetBranchAddress("RunType",&RunType);
+    RunParameters->GetEntry(0);
+
+    R.Mode = IsEfficiencyRun(RunType) ? EFFICIENCY : RATE;
+
+    RunParameters->ResetBranchAddresses();
+    delete RunType;
+
+    Uint nPartitions = Parts->GetNPartitions();
+
+    R.isNewFormat = RAWTree->GetListOfBranches()->Contains("Quality_flag");
+    R.nFileEntries = 0;
+    R.First = 0;
+    R.Last = 0;
+    R.PeakHeight = muonPeak(nPartitions,0.);
+    R.PeakTime = muonPeak(nPartitions,0.);
+    R.PeakWidth = muonPeak(nPartitions,0.);
+
+    InitLoopHistos(R.LoopH,Parts,R.Mode);
+
+    dataTree = RAWTree;
+    return true;
+}
+
+// ****************************************************************************************************
+// *    bool PublishFile(string fileName, string content)
+//
+//  Writes content into fileName through a temporary file renamed once complete, so that the file
+//  is never read half written. Returns false if the file couldn't be written.
+// ****************************************************************************************************
+
+static bool PublishFile(string fileName, string content){
+    string tmpName = fileName + "." + intToString(getpid());
+
+    ofstream file(tmpName.c_str(),ios::out);
+    file << content;
+    file.close();
+
+    if(file.fail() || rename(tmpName.c_str(),fileName.c_str()) != 0){
+        remove(tmpName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// ****************************************************************************************************
+// *    void PublishSnapshot(string baseName, AnalysisOptions& options, AnalysisSetup& setup,
+// *                         LoopResults& R, bool final, AnalysisOutput& output)
+//
+//  Runs the analysis of the entries looped over so far and publishes its results : the histograms
+//  into baseName_Offline.root and the CSV headers and rows into baseName_Online-Rate.csv,
+//  baseName_Online-Corrupted.csv and baseName_Online-L0-EffCl.csv. Each file is replaced at once
+//  by its new version. The CSV headers and rows are also kept into output. Unless final is true, the
+//  multiplicity fits of the snapshot are not added to the fit cache of the scan : the histograms of
+//  a run still being written never come back.
+// ****************************************************************************************************
+
+static void PublishSnapshot(string baseName, AnalysisOptions& options, AnalysisSetup& setup,
+                            LoopResults& R, bool final, AnalysisOutput& output){
+    string rootName = baseName + "_Offline.root";
+    string tmpName = baseName + "_Offline-" + intToString(getpid()) + ".root";
+
+    AnalysisOptions snapshotOptions = options;
+    snapshotOptions.SaveFits = options.SaveFits && final;
+
+    FinishStep(baseName,snapshotOptions,setup,R,tmpName,output);
+
+    bool published = rename(tmpName.c_str(),rootName.c_str()) == 0
+                  && PublishFile(baseName + __online + "Rate.csv",output.HeadRate + output.RowRate)
+                  && PublishFile(baseName + __online + "Corrupted.csv",output.HeadCorr + output.RowCorr)
+                  && PublishFile(baseName + __online + "L0-EffCl.csv",output.HeadEff + output.RowEff);
+
+    if(published)
+        MSG_INFO("[Online] Snapshot of " + longTostring(R.Last) + " entries published");
+    else {
+        remove(tmpName.c_str());
+        MSG_WARNING("[Online] Could not publish the snapshot of " + longTostring(R.Last) + " entries");
+    }
+}
+
+// ****************************************************************************************************
+// *    void FollowAnalysis(string baseName, AnalysisOptions& options, Uint period, Uint idle)
+//
+//  Analyses baseName_DAQ.root while it is being written. Every FOLLOWPOLL seconds, the RAWData tree
+//  is refreshed and the entries written since the last refresh are looped over. The muon peak of
+//  efficiency runs is searched once FOLLOWPEAKENTRIES entries are written and its time windows are
+//  used for the rest of the run. When new entries were analysed, a snapshot of the results is
+//  published every period seconds. The run is over when no entry was written for idle seconds :
+//  the results are then written into baseName_Offline.root and the CSV files of the scan as by the
+//  offline analysis, without reading the DAQ file again.
+// ****************************************************************************************************
+
+void FollowAnalysis(string baseName, AnalysisOptions& options, Uint period, Uint idle){
+    string scanDir = baseName.substr(0,baseName.find_last_of("/"));
+    string daqName = baseName + "_DAQ.root";
+
+    bool addDirectory = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(false);
+
+    AnalysisSetup setup;
+    LoadSetup(scanDir,setup);
+
+    PartitionTable* Parts = setup.Parts;
+    DecodeTable* Decoder = setup.Decoder;
+
+    MSG_INFO("[Online] Following " + daqName);
+
+    TFile* dataFile = NULL;
+    TTree* dataTree = NULL;
+
+    LoopResults R;
+    GIFWindowArray Windows;
+    bool hasWindows = false;
+
+    Uint nWritten = 0;    //Entries written into the DAQ file
+    Uint nAnalysed = 0;   //Entries looped over
+    bool newEntries = false;
+
+    time_t lastWrite = time(NULL);
+    time_t lastSnapshot = time(NULL);
+
+    while(true){
+        time_t now = time(NULL);
+
+        if(dataTree == NULL && StartFollowing(daqName,dataFile,dataTree,R,Parts))
+            MSG_INFO("[Online] RAWData tree found");
+
+        //Get the entries saved since the last refresh
+        if(dataTree != NULL){
+            dataTree->Refresh();
+
+            if(dataTree->GetEntries() > nWritten){
+                nWritten = dataTree->GetEntries();
+                lastWrite = now;
+            }
+        }
+
+        bool runOver = (now - lastWrite >= (time_t)idle);
+
+        //The time windows are needed before the first loop. Rate runs
+        //have no muon peak to look for.
+        if(dataTree != NULL && !hasWindows){
+            if(R.Mode == RATE){
+                hasWindows = true;
+            } else if(nWritten >= FOLLOWPEAKENTRIES || (runOver && nWritten > 0)){
+                MSG_INFO("[Online] Muon peak searched on the first " + longTostring(nWritten) + " entries");
+                SetTreeReading(dataTree,R.isNewFormat,0,nWritten,options.CacheSizeMB);
+                SetBeamWindow(R.PeakHeight,R.PeakTime,R.PeakWidth,dataTree,Decoder,Parts);
+                hasWindows = true;
+            }
+
+            if(hasWindows) SetTimeWindows(R.PeakTime,R.PeakWidth,Windows);
+        }
+
+        if(hasWindows && nWritten > nAnalysed){
+            SetTreeReading(dataTree,R.isNewFormat,nAnalysed,nWritten,options.CacheSizeMB);
+            ProcessEntries(dataTree,nAnalysed,nWritten,R.LoopH,Windows,R.Mode,R.isNewFormat,Decoder,Parts);
+
+            nAnalysed = nWritten;
+            R.nFileEntries = nAnalysed;
+            R.Last = nAnalysed;
+            newEntries = true;
+        }
+
+        if(runOver) break;
+
+        if(newEntries && now - lastSnapshot >= (time_t)period){
+            AnalysisOutput snapshot;
+            PublishSnapshot(baseName,options,setup,R,false,snapshot);
+
+            lastSnapshot = now;
+            newEntries = false;
+        }
+
+        this_thread::sleep_for(chrono::seconds(FOLLOWPOLL));
+    }
+
+    //The run is over : the last snapshot gives the results of the run
+    if(nAnalysed > 0){
+        MSG_INFO("[Online] No new entry for " + intToString(idle) + " s, " + longTostring(nAnalysed)
+                 + " entries analysed");
+
+        AnalysisOutput output;
+        PublishSnapshot(baseName,options,setup,R,true,output);
+        WriteOutput(scanDir,output);
+    } else
+        MSG_ERROR("[Online] No entry written into " + daqName + " for " + intToString(idle) + " s");
+
+    if(dataFile != NULL){
+        dataFile->Close();
+        delete dataFile;
+    }
+
+    DeleteSetup(setup);
+
+    TH1::AddDirectory(addDirectory);
+}
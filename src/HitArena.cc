@@ -0,0 +1,179 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    HitArena.cc
+// *
+// *    Class that defines HitArena objects. The arena collects
+// *    the hits of an event for all the active partitions of
+// *    the infrastructure into a single hit store. The hits
+// *    are first staged in reading order while counting them
+// *    per partition and then scattered into contiguous index
+// *    ranges of the store, one per partition (peak hits first
+// *    and then noise hits). The memory of the arena is kept
+// *    from one event to the next.
+//***************************************************************
+
+#include <vector>
+#include <algorithm>
+
+#include "../include/HitArena.h"
+#include "../include/RPCHit.h"
+#include "../include/types.h"
+
+using namespace std;
+
+// ****************************************************************************************************
+// *    HitArena()
+//
+//  Default constructor
+// ****************************************************************************************************
+
+HitArena::HitArena(){
+    Offset.assign(1,0);
+}
+
+// ****************************************************************************************************
+// *    HitArena(Uint nPartitions)
+//
+//  Constructor. nPartitions is the number of active partitions (see DecodeTable::GetNPartitions()).
+// ****************************************************************************************************
+
+HitArena::HitArena(Uint nPartitions){
+    nHits.assign(nPartitions,0);
+    nPeak.assign(nPartitions,0);
+    nFake.assign(nPartitions,0);
+    Offset.assign(nPartitions+1,0);
+    PeakCursor.assign(nPartitions,0);
+    NoiseCursor.assign(nPartitions,0);
+}
+
+// ****************************************************************************************************
+// *    ~HitArena()
+//
+//  Destructor
+// ****************************************************************************************************
+
+HitArena::~HitArena(){
+
+}
+
+// ****************************************************************************************************
+// *    void Clear()
+//
+//  Empties the arena before a new event. The counters are reset but the memory of the staging
+//  buffer and of the store is kept.
+// ****************************************************************************************************
+
+void HitArena::Clear(){
+    Staged.clear();
+    fill(nHits.begin(),nHits.end(),0);
+    fill(nPeak.begin(),nPeak.end(),0);
+    fill(nFake.begin(),nFake.end(),0);
+}
+
+// ****************************************************************************************************
+// *    void Scatter()
+//
+//  Computes the start of each partition range from the counts of the staged hits and copies every
+//  staged hit into its range : the peak hits fill the beginning of the range and the noise hits the
+//  rest, both keeping the reading order.
+// ****************************************************************************************************
+
+void HitArena::Scatter(){
+    Uint nPartitions = nHits.size();
+
+    for(Uint i = 0; i < nPartitions; i++)
+        Offset[i+1] = Offset[i] + nHits[i];
+
+    Hits.Strip.resize(Staged.size());
+    Hits.Time.resize(Staged.size());
+
+    //Write cursors for the peak and noise hits of each partition.
+    //The noise hits start right after the last peak hit.
+    for(Uint i = 0; i < nPartitions; i++){
+        PeakCursor[i] = Offset[i];
+        NoiseCursor[i] = Offset[i] + nPeak[i];
+    }
+
+    for(Uint h = 0; h < Staged.size(); h++){
+        const StagedHit& hit = Staged[h];
+        Uint pos = hit.Peak ? PeakCursor[hit.Index]++ : NoiseCursor[hit.Index]++;
+
+        Hits.Strip[pos] = hit.Strip;
+        Hits.Time[pos] = hit.Time;
+    }
+}
+
+// ****************************************************************************************************
+// *    const HitStore& GetHits() const
+//
+//  Get the private member Hits, the store in which the partition ranges are defined
+// ****************************************************************************************************
+
+const HitStore& HitArena::GetHits() const {
+    return Hits;
+}
+
+// ****************************************************************************************************
+// *    Uint GetNHits(Uint index) const
+//
+//  Get the number of hits of the partition with dense index index
+// ****************************************************************************************************
+
+Uint HitArena::GetNHits(Uint index) const {
+    return nHits[index];
+}
+
+// ****************************************************************************************************
+// *    Uint GetNPeak(Uint index) const
+//
+//  Get the number of hits of the partition with dense index index that are in the muon peak window
+// ****************************************************************************************************
+
+Uint HitArena::GetNPeak(Uint index) const {
+    return nPeak[index];
+}
+
+// ****************************************************************************************************
+// *    Uint GetNFake(Uint index) const
+//
+//  Get the number of hits of the partition with dense index index that are in the fake window
+// ****************************************************************************************************
+
+Uint HitArena::GetNFake(Uint index) const {
+    return nFake[index];
+}
+
+// ****************************************************************************************************
+// *    Uint GetFirstPeak(Uint index) const
+//
+//  Get the position in the store of the first peak hit of the partition with dense index index
+// ****************************************************************************************************
+
+Uint HitArena::GetFirstPeak(Uint index) const {
+    return Offset[index];
+}
+
+// ****************************************************************************************************
+// *    Uint GetFirstNoise(Uint index) const
+//
+//  Get the position in the store of the first noise hit of the partition with dense index index. It
+//  is also the end of the range of peak hits.
+// ****************************************************************************************************
+
+Uint HitArena::GetFirstNoise(Uint index) const {
+    return Offset[index] + nPeak[index];
+}
+
+// ****************************************************************************************************
+// *    Uint GetLastNoise(Uint index) const
+//
+//  Get the end of the range of noise hits of the partition with dense index index
+// ****************************************************************************************************
+
+Uint HitArena::GetLastNoise(Uint index) const {
+    return Offset[index+1];
+}
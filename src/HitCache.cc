@@ -0,0 +1,287 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    HitCache.cc
+// *
+// *    Compact hit cache of a DAQ file used to analyse the same
+// *    file again without reading and decompressing the ROOT
+// *    file. The hits are stored already decoded into the dense
+// *    index of their partition and their strip, with a table
+// *    giving the first hit of each entry. The file is mapped
+// *    into memory and read in place. The cache is only valid
+// *    for the DAQ file, mapping and geometry it was made with.
+//***************************************************************
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/HitCache.h"
+#include "../include/DecodeTable.h"
+#include "../include/MsgSvc.h"
+#include "../include/types.h"
+#include "../include/utils.h"
+
+using namespace std;
+
+//Identifier written at the beginning of every cache file
+static const char HITCACHEMAGIC[8] = {'G','I','F','H','I','T','S','\0'};
+
+// ****************************************************************************************************
+// *    HitCache()
+//
+//  Default constructor. The cache is closed.
+// ****************************************************************************************************
+
+HitCache::HitCache(){
+    Map = NULL;
+    MapSize = 0;
+    Header = NULL;
+    EntryOffset = NULL;
+    Corrupted = NULL;
+    Index = NULL;
+    Strip = NULL;
+    Time = NULL;
+}
+
+// ****************************************************************************************************
+// *    ~HitCache()
+//
+//  Destructor. Unmaps the file.
+// ****************************************************************************************************
+
+HitCache::~HitCache(){
+    Close();
+}
+
+// ****************************************************************************************************
+// *    bool Open(string cacheName, const HitCacheKeys& keys)
+//
+//  Maps the cache file cacheName into memory. Returns false, leaving the cache closed, if the file
+//  doesn't exist, is not a cache of the current version or was made with other keys than keys.
+// ****************************************************************************************************
+
+bool HitCache::Open(string cacheName, const HitCacheKeys& keys){
+    Close();
+
+    int fd = open(cacheName.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat info;
+    if(fstat(fd,&info) != 0 || (size_t)info.st_size < sizeof(HitCacheHeader)){
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(map == MAP_FAILED) return false;
+
+    Map = (char*)map;
+    MapSize = info.st_size;
+    Header = (const HitCacheHeader*)Map;
+
+    bool valid = memcmp(Header->Magic,HITCACHEMAGIC,sizeof(HITCACHEMAGIC)) == 0
+              && Header->Version == HITCACHEVERSION
+              && Header->FileSize == MapSize
+              && Header->Keys.DAQKey == keys.DAQKey
+              && Header->Keys.MappingKey == keys.MappingKey
+              && Header->Keys.DimensionsKey == keys.DimensionsKey
+              && Header->Keys.nEntries == keys.nEntries
+              && Header->Keys.nPartitions == keys.nPartitions
+              && Header->TimePos + (unsigned long long)Header->nHits*sizeof(float) <= MapSize;
+
+    if(!valid){
+        MSG_INFO("[Offline] Hit cache " + cacheName + " out of date");
+        Close();
+        return false;
+    }
+
+    EntryOffset = (const Uint*)(Map + Header->EntryOffsetPos);
+    Corrupted = (const unsigned char*)(Map + Header->CorruptedPos);
+    Index = (const unsigned short*)(Map + Header->IndexPos);
+    Strip = (const unsigned short*)(Map + Header->StripPos);
+    Time = (const float*)(Map + Header->TimePos);
+
+    //The hits are read from the first to the last entry
+    madvise(Map, MapSize, MADV_SEQUENTIAL);
+
+    return true;
+}
+
+// ****************************************************************************************************
+// *    void Close()
+// *    bool IsOpen()
+//
+//  Unmaps the file / Tells if a file is mapped.
+// ****************************************************************************************************
+
+void HitCache::Close(){
+    if(Map != NULL) munmap(Map, MapSize);
+
+    Map = NULL;
+    MapSize = 0;
+    Header = NULL;
+    EntryOffset = NULL;
+    Corrupted = NULL;
+    Index = NULL;
+    Strip = NULL;
+    Time = NULL;
+}
+
+bool HitCache::IsOpen() const {
+    return Map != NULL;
+}
+
+// ****************************************************************************************************
+// *    Uint GetNEntries()
+// *    Uint GetNHits()
+//
+//  Get the number of entries of the DAQ file / the number of hits kept in the cache.
+// ****************************************************************************************************
+
+Uint HitCache::GetNEntries() const {
+    return Header->Keys.nEntries;
+}
+
+Uint HitCache::GetNHits() const {
+    return Header->nHits;
+}
+
+// ****************************************************************************************************
+// *    void GetHitCacheKeys(const vector<string>& daqNames, string mappath, string dimpath,
+// *                         Uint nEntries, Uint nPartitions, HitCacheKeys& keys)
+//
+//  Gets the keys of the cache of the DAQ files daqNames of a run analysed with the mapping mappath
+//  and the geometry dimpath. The DAQ files are too large to be hashed and are only identified by
+//  their size and modification time. The key of a run written into a single file only depends on
+//  this file.
+// ****************************************************************************************************
+
+void GetHitCacheKeys(const vector<string>& daqNames, string mappath, string dimpath,
+                     Uint nEntries, Uint nPartitions, HitCacheKeys& keys){
+    keys.DAQKey = 0;
+
+    for(Uint f = 0; f < daqNames.size(); f++){
+        struct stat info;
+        unsigned long long fileKey = 0;
+
+        if(stat(daqNames[f].c_str(),&info) == 0)
+            fileKey = ((unsigned long long)info.st_size << 20) ^ (unsigned long long)info.st_mtime;
+
+        keys.DAQKey = keys.DAQKey*1099511628211ULL ^ fileKey;
+    }
+
+    keys.MappingKey = GetFileHash(mappath);
+    keys.DimensionsKey = GetFileHash(dimpath);
+    keys.nEntries = nEntries;
+    keys.nPartitions = nPartitions;
+}
+
+// ****************************************************************************************************
+// *    void WriteSection(ofstream& file, unsigned long long& pos, unsigned long long start,
+// *                      const void* data, size_t size)
+//
+//  Writes size bytes of data into file at the position start, filling the gap since the current
+//  position pos with zeros, and moves pos after the section.
+// ****************************************************************************************************
+
+static void WriteSection(ofstream& file, unsigned long long& pos, unsigned long long start,
+                         const void* data, size_t size){
+    for(; pos < start; pos++) file.put(0);
+
+    file.write((const char*)data,size);
+    pos += size;
+}
+
+// ****************************************************************************************************
+// *    bool WriteHitCache(string cacheName, RAWDataBuffer& buffer, DecodeTable* Decoder,
+// *                       const HitCacheKeys& keys)
+//
+//  Converts the content of the DAQ files loaded into buffer with ReadRAWData(...) into the cache file
+//  cacheName. Only the hits of the channels linked to a partition are kept, in reading order. The
+//  hits of corrupted entries are kept for the muon peak search. The file is first written under a
+//  temporary name and then renamed so that another analysis never maps a partial file. Returns
+//  false if the file couldn't be written.
+// ****************************************************************************************************
+
+bool WriteHitCache(string cacheName, RAWDataBuffer& buffer, DecodeTable* Decoder,
+                   const HitCacheKeys& keys){
+    Uint nEntries = buffer.QFlag.size();
+
+    vector<Uint>           EntryOffset;
+    vector<unsigned char>  Corrupted;
+    vector<unsigned short> Index;
+    vector<unsigned short> Strip;
+    vector<float>          Time;
+
+    EntryOffset.reserve(nEntries+1);
+    Corrupted.reserve(nEntries);
+
+    for(Uint e = 0; e < nEntries; e++){
+        EntryOffset.push_back(Time.size());
+        Corrupted.push_back(IsCorruptedEvent(buffer.QFlag[e]));
+
+        for(Uint h = buffer.EntryOffset[e]; h < buffer.EntryOffset[e+1]; h++){
+            const ChannelCode& code = Decoder->Decode(buffer.TDCCh[h]);
+            if(code.Partition == NOCHANNELLINK) continue;
+
+            //Same selection as FillBeamProfile(...)
+            unsigned short index = code.Index;
+            if(buffer.TDCCh[h] > 5127) index |= NOBEAMHIT;
+
+            Index.push_back(index);
+            Strip.push_back(code.Strip);
+            Time.push_back(buffer.TDCTS[h]);
+        }
+    }
+    EntryOffset.push_back(Time.size());
+
+    //Place the sections one after the other at multiples of 8 bytes
+    HitCacheHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.Magic,HITCACHEMAGIC,sizeof(HITCACHEMAGIC));
+
+    Uint nHits = Time.size();
+
+    header.Version = HITCACHEVERSION;
+    header.nHits = nHits;
+    header.Keys = keys;
+    header.EntryOffsetPos = (sizeof(header)+7) & ~7ULL;
+    header.CorruptedPos = (header.EntryOffsetPos + (nEntries+1)*sizeof(Uint) + 7) & ~7ULL;
+    header.IndexPos = (header.CorruptedPos + nEntries + 7) & ~7ULL;
+    header.StripPos = (header.IndexPos + nHits*sizeof(unsigned short) + 7) & ~7ULL;
+    header.TimePos = (header.StripPos + nHits*sizeof(unsigned short) + 7) & ~7ULL;
+    header.FileSize = header.TimePos + nHits*sizeof(float);
+
+    string tmpName = cacheName + "." + intToString(getpid());
+    ofstream cacheFile(tmpName.c_str(), ios::out | ios::binary);
+
+    unsigned long long pos = 0;
+
+    WriteSection(cacheFile,pos,0,&header,sizeof(header));
+    WriteSection(cacheFile,pos,header.EntryOffsetPos,EntryOffset.data(),EntryOffset.size()*sizeof(Uint));
+    WriteSection(cacheFile,pos,header.CorruptedPos,Corrupted.data(),Corrupted.size());
+    WriteSection(cacheFile,pos,header.IndexPos,Index.data(),Index.size()*sizeof(unsigned short));
+    WriteSection(cacheFile,pos,header.StripPos,Strip.data(),Strip.size()*sizeof(unsigned short));
+    WriteSection(cacheFile,pos,header.TimePos,Time.data(),Time.size()*sizeof(float));
+    cacheFile.close();
+
+    if(cacheFile.fail() || rename(tmpName.c_str(),cacheName.c_str()) != 0){
+        MSG_WARNING("[Offline] Could not save the hit cache " + cacheName);
+        remove(tmpName.c_str());
+        return false;
+    }
+
+    MSG_INFO("[Offline] Hit cache saved into " + cacheName);
+    return true;
+}
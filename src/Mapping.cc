@@ -34,7 +34,7 @@ using namespace std;
 // ****************************************************************************************************
 
 Mapping::Mapping(){
-
+    BuildTable();
 }
 
 // ****************************************************************************************************
@@ -45,6 +45,7 @@ Mapping::Mapping(){
 
 Mapping::Mapping(string baseName){
     SetFileName(baseName);
+    BuildTable();
 }
 
 // ****************************************************************************************************
@@ -133,6 +134,8 @@ int Mapping::Read(){
 
         map.close();
 
+        BuildTable();
+
         return Error;
     } else {
         Error = MAP_ERROR_CANNOT_OPEN_READ_FILE;
@@ -142,14 +145,32 @@ int Mapping::Read(){
     }
 }
 
+// ****************************************************************************************************
+// *    void BuildTable()
+//
+//  Private method that compiles the content of Link into the dense table used by Decode().
+//  The table is indexed by TDC channel up to the highest channel in the mapping and an extra empty
+//  word is added at the end for the channels that are not in the mapping.
+// ****************************************************************************************************
+
+void Mapping::BuildTable(){
+    LastChannel = Link.empty() ? 0 : Link.rbegin()->first + 1;
+    Table.assign(LastChannel+1, NOCHANNELLINK);
+
+    for(MappingData::iterator it = Link.begin(); it != Link.end(); it++)
+        Table[it->first] = it->second;
+}
+
 // ****************************************************************************************************
 // *    Uint GetLink(Uint tdcchannel)
 //
-//  Get link in betweeen TDC channel tdcchannel and the corresponding RPC channel.
+//  Get link in betweeen TDC channel tdcchannel and the corresponding RPC channel. Channels that are
+//  not in the mapping are not added to it.
 // ****************************************************************************************************
 
 Uint Mapping::GetLink(Uint tdcchannel){
-    return Link[tdcchannel];
+    MappingData::iterator it = Link.find(tdcchannel);
+    return (it != Link.end()) ? it->second : NOCHANNELLINK;
 }
 
 // ****************************************************************************************************
@@ -159,7 +180,8 @@ Uint Mapping::GetLink(Uint tdcchannel){
 // ****************************************************************************************************
 
 Uint Mapping::GetReverse(Uint rpcchannel){
-    return ReverseLink[rpcchannel];
+    MappingData::iterator it = ReverseLink.find(rpcchannel);
+    return (it != ReverseLink.end()) ? it->second : 0;
 }
 
 // ****************************************************************************************************
@@ -169,5 +191,16 @@ Uint Mapping::GetReverse(Uint rpcchannel){
 // ****************************************************************************************************
 
 Uint Mapping::GetMask(Uint rpcchannel){
-    return Mask[rpcchannel];
+    MappingData::iterator it = Mask.find(rpcchannel);
+    return (it != Mask.end()) ? it->second : MASKED;
+}
+
+// ****************************************************************************************************
+// *    Uint GetTableSize()
+//
+//  Get the private member LastChannel, the number of TDC channels covered by the dense table.
+// ****************************************************************************************************
+
+Uint Mapping::GetTableSize() const {
+    return LastChannel;
 }
@@ -0,0 +1,118 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    MultCounter.cc
+// *
+// *    Class that defines MultCounter objects. A counter
+// *    collects a multiplicity distribution (number of hits or
+// *    of clusters per event) as plain integers during the
+// *    loop over the entries. Its range grows with the largest
+// *    multiplicity filled and the ROOT histogram is only built
+// *    once the loop is over, with its final range.
+//***************************************************************
+
+#include <vector>
+#include <iostream>
+
+#include "TH1I.h"
+
+#include "../include/MultCounter.h"
+#include "../include/types.h"
+
+using namespace std;
+
+// ****************************************************************************************************
+// *    MultCounter()
+//
+//  Default constructor
+// ****************************************************************************************************
+
+MultCounter::MultCounter(){
+
+}
+
+// ****************************************************************************************************
+// *    ~MultCounter()
+//
+//  Destructor
+// ****************************************************************************************************
+
+MultCounter::~MultCounter(){
+
+}
+
+// ****************************************************************************************************
+// *    void Add(const MultCounter& other)
+//
+//  Adds the content of the counter other to this one.
+// ****************************************************************************************************
+
+void MultCounter::Add(const MultCounter& other){
+    if(other.Counts.size() > Counts.size())
+        Counts.resize(other.Counts.size(),0);
+
+    for(Uint m = 0; m < other.Counts.size(); m++)
+        Counts[m] += other.Counts[m];
+}
+
+// ****************************************************************************************************
+// *    Uint GetNBins()
+//
+//  Returns the number of bins needed to contain every multiplicity filled into the counter : the
+//  default MINMULTBINS bins or, when the multiplicity went beyond, the largest multiplicity + 10.
+// ****************************************************************************************************
+
+Uint MultCounter::GetNBins() const{
+    if(Counts.size() <= MINMULTBINS)
+        return MINMULTBINS;
+    else
+        return Counts.size()-1 + MINMULTBINS;
+}
+
+// ****************************************************************************************************
+// *    TH1* MakeHisto(const char* name, const char* title, Uint nBins)
+//
+//  Builds the histogram of the multiplicity distribution with nBins bins (from -0.5 to nBins-0.5).
+//  The statistics of the histogram are computed from the bin contents that are all integers.
+// ****************************************************************************************************
+
+TH1* MultCounter::MakeHisto(const char* name, const char* title, Uint nBins) const{
+    TH1* H = new TH1I(name, title, nBins, -0.5, nBins-0.5);
+
+    for(Uint m = 0; m < Counts.size(); m++)
+        if(Counts[m] > 0) H->SetBinContent(m+1,Counts[m]);
+
+    H->ResetStats();
+
+    return H;
+}
+
+// ****************************************************************************************************
+// *    void Save(ostream& out)
+// *    bool Load(istream& in)
+//
+//  Writes the counts into the binary stream out, preceded by their number / Replaces the counts by
+//  the ones read from in. Load returns false if the stream is too short.
+// ****************************************************************************************************
+
+void MultCounter::Save(ostream& out) const{
+    Uint size = Counts.size();
+
+    out.write((const char*)&size,sizeof(size));
+    out.write((const char*)Counts.data(),size*sizeof(Uint));
+}
+
+bool MultCounter::Load(istream& in){
+    Uint size = 0;
+
+    in.read((char*)&size,sizeof(size));
+    if(in.fail()) return false;
+
+    Counts.assign(size,0);
+    in.read((char*)Counts.data(),size*sizeof(Uint));
+
+    return !in.fail();
+}
@@ -0,0 +1,260 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    MultFit.cc
+// *
+// *    Fits of the hit multiplicity of old format files (no
+// *    quality flag) used to estimate the amount of corrupted
+// *    data. The fits of the partitions are shared by several
+// *    threads and their results are kept in a cache file
+// *    keyed by the minimizer and the content of the
+// *    multiplicity histograms so that the same file is never
+// *    fitted twice.
+//***************************************************************
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <unistd.h>
+
+#include "TH1.h"
+#include "TF1.h"
+#include "TList.h"
+#include "TMath.h"
+
+#include "../include/MultFit.h"
+#include "../include/MsgSvc.h"
+#include "../include/types.h"
+#include "../include/utils.h"
+
+using namespace std;
+
+// ****************************************************************************************************
+// *    unsigned long long GetMultKey(TH1* H)
+//
+//  Returns the key of the multiplicity histogram H in the cache : a FNV-1a hash of the name of the
+//  minimizer of the fits, of its number of bins and of the contents of all its bins, under and
+//  overflow included. The results of another minimizer are this way never reused.
+// ****************************************************************************************************
+
+unsigned long long GetMultKey(TH1* H){
+    unsigned long long key = 14695981039346656037ULL;
+    int nBins = H->GetNbinsX();
+
+    for(Uint c = 0; c < PARALLELMINIMIZER.size(); c++){
+        key ^= (unsigned char)PARALLELMINIMIZER[c];
+        key *= 1099511628211ULL;
+    }
+
+    vector<double> words(1,(double)nBins);
+    for(int b = 0; b <= nBins+1; b++)
+        words.push_back(H->GetBinContent(b));
+
+    const unsigned char* bytes = (const unsigned char*)words.data();
+    for(Uint c = 0; c < words.size()*sizeof(double); c++){
+        key ^= bytes[c];
+        key *= 1099511628211ULL;
+    }
+
+    return key;
+}
+
+// ****************************************************************************************************
+// *    double EvalSkew(const SkewParams& skew, double x)
+//
+//  Returns the value of the skew function of parameters skew at x (same as SKEWFORMULA).
+// ****************************************************************************************************
+
+double EvalSkew(const SkewParams& skew, double x){
+    const double* p = skew.Par;
+
+    return p[0]*TMath::Exp(-0.5*((x-p[1])/p[2])*((x-p[1])/p[2])) / (1 + TMath::Exp(-p[3]*(x-p[4])));
+}
+
+// ****************************************************************************************************
+// *    void FitSkew(TH1* H, double Xmax, Uint id, SkewParams& skew)
+//
+//  Fits the hit multiplicity H first with a gaussian that is used to initialise the parameters of
+//  the skew fit (it works better this way) and saves the parameters of the skew fit. The fits are
+//  not stored into H. id makes the names of the functions unique when several fits run at once.
+// ****************************************************************************************************
+
+void FitSkew(TH1* H, double Xmax, Uint id, SkewParams& skew){
+    string gaussName = "gaussfit" + intToString(id);
+    string skewName  = "skewfit" + intToString(id);
+
+    TF1 GaussFit(gaussName.c_str(),"[0]*exp(-0.5*((x-[1])/[2])**2)",0,Xmax);
+    GaussFit.SetParameter(0,100);
+    GaussFit.SetParameter(1,10);
+    GaussFit.SetParameter(2,1);
+    H->Fit(&GaussFit,"LIQRN","",0.5,Xmax);
+
+    TF1 SkewFit(skewName.c_str(),SKEWFORMULA,0,Xmax);
+    SkewFit.SetParameter(0,GaussFit.GetParameter(0));
+    SkewFit.SetParameter(1,GaussFit.GetParameter(1));
+    SkewFit.SetParameter(2,GaussFit.GetParameter(2));
+    SkewFit.SetParameter(3,1);
+    SkewFit.SetParameter(4,1);
+    H->Fit(&SkewFit,"LIQRN","",0.5,Xmax);
+
+    for(Uint p = 0; p < NSKEWPARS; p++)
+        skew.Par[p] = SkewFit.GetParameter(p);
+}
+
+// ****************************************************************************************************
+// *    void ReadSkewCache(string cacheName, SkewCache& cache)
+//
+//  Reads the fit results saved into the cache file cacheName. Each line contains the key of a
+//  histogram (hexadecimal) followed by the parameters of its skew fit. A missing file gives an
+//  empty cache.
+// ****************************************************************************************************
+
+void ReadSkewCache(string cacheName, SkewCache& cache){
+    ifstream cacheFile(cacheName.c_str(), ios::in);
+    string line;
+
+    while(getline(cacheFile,line)){
+        istringstream entry(line);
+        unsigned long long key;
+        SkewParams skew;
+
+        entry >> hex >> key >> dec;
+        for(Uint p = 0; p < NSKEWPARS; p++)
+            entry >> skew.Par[p];
+
+        if(!entry.fail()) cache[key] = skew;
+    }
+}
+
+// ****************************************************************************************************
+// *    void WriteSkewCache(string cacheName, SkewCache& cache)
+//
+//  Saves the content of cache into the cache file cacheName. The file is first written under a
+//  temporary name and then renamed so that another analysis never reads a partial file.
+// ****************************************************************************************************
+
+void WriteSkewCache(string cacheName, SkewCache& cache){
+    string tmpName = cacheName + "." + intToString(getpid());
+    ofstream cacheFile(tmpName.c_str(), ios::out);
+
+    cacheFile << setprecision(17);
+
+    for(SkewCache::iterator it = cache.begin(); it != cache.end(); it++){
+        cacheFile << hex << it->first << dec;
+        for(Uint p = 0; p < NSKEWPARS; p++)
+            cacheFile << '\t' << it->second.Par[p];
+        cacheFile << '\n';
+    }
+
+    cacheFile.close();
+
+    if(cacheFile.fail() || rename(tmpName.c_str(),cacheName.c_str()) != 0){
+        MSG_WARNING("[Offline] Could not save the fit cache " + cacheName);
+        remove(tmpName.c_str());
+    }
+}
+
+//Protects the cache file against HV steps analysed at once
+static mutex SkewCacheMutex;
+
+// ****************************************************************************************************
+// *    void FitMultiplicities(GIFH1Array& HitMultiplicity, GIFnBinsMult& nBinsMult,
+// *                           Uint nThreads, string cacheName, GIFSkewArray& Skews)
+//
+//  Gets the skew fit of the hit multiplicity of every partition. The results found in the cache
+//  file cacheName are used as is and the remaining histograms are fitted by nThreads threads that
+//  pick the partitions one after the other. The fits always use the minimizer of the parallel fits
+//  so that the results don't depend on the number of threads. Each result is saved at the index of
+//  its partition and the new results are added to the cache, unless cacheName is empty. Finally,
+//  the skew function is attached to every histogram, in the order of the partitions, as a fit would
+//  have done.
+// ****************************************************************************************************
+
+void FitMultiplicities(GIFH1Array& HitMultiplicity, GIFnBinsMult& nBinsMult,
+                       Uint nThreads, string cacheName, GIFSkewArray& Skews){
+    Uint nPartitions = HitMultiplicity.size();
+
+    SkewCache cache;
+    ReadSkewCache(cacheName,cache);
+
+    //List the partitions that are not in the cache yet
+    vector<unsigned long long> Keys(nPartitions);
+    vector<Uint> ToFit;
+
+    Skews.rpc.assign(nPartitions,SkewParams());
+
+    for(Uint i = 0; i < nPartitions; i++){
+        Keys[i] = GetMultKey(HitMultiplicity.rpc[i]);
+
+        SkewCache::iterator found = cache.find(Keys[i]);
+        if(found != cache.end())
+            Skews.rpc[i] = found->second;
+        else
+            ToFit.push_back(i);
+    }
+
+    if(nThreads > ToFit.size()) nThreads = ToFit.size();
+
+    string minimizer, algorithm;
+    EnableParallelFits(minimizer,algorithm);
+
+    if(nThreads <= 1){
+        for(Uint f = 0; f < ToFit.size(); f++){
+            Uint i = ToFit[f];
+            FitSkew(HitMultiplicity.rpc[i],(double)nBinsMult.rpc[i],i,Skews.rpc[i]);
+        }
+    } else {
+        MSG_INFO("[Offline] Multiplicity fits split over " + intToString(nThreads) + " threads");
+
+        atomic<Uint> next(0);
+        vector<thread> Workers;
+
+        for(Uint w = 0; w < nThreads; w++){
+            Workers.push_back(thread([&](){
+                for(Uint f = next++; f < ToFit.size(); f = next++){
+                    Uint i = ToFit[f];
+                    FitSkew(HitMultiplicity.rpc[i],(double)nBinsMult.rpc[i],i,Skews.rpc[i]);
+                }
+            }));
+        }
+
+        for(Uint w = 0; w < nThreads; w++)
+            Workers[w].join();
+    }
+
+    RestoreMinimizer(minimizer,algorithm);
+
+    //Save the new results. The cache file is read again in case other
+    //HV steps of the scan saved their own results in the meantime.
+    if(ToFit.size() > 0 && cacheName != ""){
+        lock_guard<mutex> lock(SkewCacheMutex);
+
+        SkewCache saved;
+        ReadSkewCache(cacheName,saved);
+
+        for(Uint f = 0; f < ToFit.size(); f++)
+            saved[Keys[ToFit[f]]] = Skews.rpc[ToFit[f]];
+
+        WriteSkewCache(cacheName,saved);
+    }
+
+    //Draw the skew fits on the histograms
+    TF1 SkewFit("skewfit",SKEWFORMULA,0,1);
+
+    for(Uint i = 0; i < nPartitions; i++){
+        TF1* curve = (TF1*)SkewFit.Clone();
+        curve->SetRange(0,(double)nBinsMult.rpc[i]);
+        for(Uint p = 0; p < NSKEWPARS; p++)
+            curve->SetParameter(p,Skews.rpc[i].Par[p]);
+
+        HitMultiplicity.rpc[i]->GetListOfFunctions()->Add(curve);
+    }
+}
@@ -19,12 +19,20 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <cstdio>
+#include <ctime>
 #include <fstream>
+#include <sstream>
 #include <vector>
+#include <algorithm>
 #include <cmath>
+#include <thread>
+#include <atomic>
 
+#include "TROOT.h"
 #include "TFile.h"
 #include "TTree.h"
+#include "TChain.h"
 #include "TString.h"
 #include "TH1F.h"
 #include "TH1I.h"
@@ -38,6 +46,16 @@
 #include "../include/IniFile.h"
 #include "../include/MsgSvc.h"
 #include "../include/Mapping.h"
+#include "../include/DecodeTable.h"
+#include "../include/PartitionTable.h"
+#include "../include/HitArena.h"
+#include "../include/MultCounter.h"
+#include "../include/FlatHisto.h"
+#include "../include/EventPipeline.h"
+#include "../include/HitCache.h"
+#include "../include/PartialResults.h"
+#include "../include/PeakFinder.h"
+#include "../include/MultFit.h"
 #include "../include/Infrastructure.h"
 #include "../include/Cluster.h"
 #include "../include/RPCHit.h"
@@ -48,42 +66,693 @@ using namespace std;
 
 //*******************************************************************************
 
-void OfflineAnalysis(string baseName){
+// ****************************************************************************************************
+// *    void InitLoopHistos(GIFLoopHistos& histos, PartitionTable* Parts, RunMode Mode)
+//
+//  Sizes every array of the set of loop histograms for the active partitions of Parts and sets the
+//  binning of the accumulators. The content of an accumulator is only allocated with its first fill
+//  and the muon accumulators are only given a binning for efficiency runs. The multiplicity counters
+//  start empty.
+// ****************************************************************************************************
+
+void InitLoopHistos(GIFLoopHistos& histos, PartitionTable* Parts, RunMode Mode){
+    Uint nPartitions = Parts->GetNPartitions();
+
+    histos.TimeProfile.rpc.assign(nPartitions,FlatH1());
+    histos.HitProfile.rpc.assign(nPartitions,FlatH1());
+    histos.HitMultiplicity.rpc.assign(nPartitions,MultCounter());
+    histos.TimeVSChanProfile.rpc.assign(nPartitions,FlatH2());
+    histos.StripNoiseProfile.rpc.assign(nPartitions,FlatH1());
+    histos.NoiseCSize.rpc.assign(nPartitions,FlatH1());
+    histos.NoiseCMult.rpc.assign(nPartitions,MultCounter());
+    histos.BeamProfile.rpc.assign(nPartitions,FlatH1());
+    histos.EfficiencyFake.rpc.assign(nPartitions,FlatH1());
+    histos.EfficiencyPeak.rpc.assign(nPartitions,FlatH1());
+    histos.PeakCSize.rpc.assign(nPartitions,FlatH1());
+    histos.PeakCMult.rpc.assign(nPartitions,MultCounter());
+
+    //Time profile binning
+    float timeWidth = 1.;
+
+    if(Mode == EFFICIENCY)
+        timeWidth = BMTDCWINDOW;
+    else
+        timeWidth = RDMTDCWINDOW;
+
+    int nBinsTime = (int)timeWidth/TIMEBIN;
+
+    for (Uint i = 0; i < nPartitions; i++){
+        const PartitionInfo& part = Parts->GetInfo(i);
+        Uint p = part.Partition;
+
+        //Strip bining
+        Uint nStrips = part.nStrips;
+        float low_s = nStrips*p + 0.5;
+        float high_s = nStrips*(p+1) + 0.5;
+
+        histos.TimeProfile.rpc[i].SetBinning(nBinsTime, 0., timeWidth);
+        histos.HitProfile.rpc[i].SetBinning(nStrips, low_s, high_s);
+        histos.TimeVSChanProfile.rpc[i].SetBinning(nStrips, low_s, high_s, nBinsTime, 0., timeWidth);
+        histos.StripNoiseProfile.rpc[i].SetBinning(nStrips, low_s, high_s);
+        histos.NoiseCSize.rpc[i].SetBinning(nStrips, 0.5, nStrips+0.5);
+
+        if(Mode != EFFICIENCY) continue;
+
+        histos.BeamProfile.rpc[i].SetBinning(nStrips, low_s, high_s);
+        histos.EfficiencyFake.rpc[i].SetBinning(2, -0.5, 1.5);
+        histos.EfficiencyPeak.rpc[i].SetBinning(2, -0.5, 1.5);
+        histos.PeakCSize.rpc[i].SetBinning(nStrips, 0.5, nStrips+0.5);
+    }
+}
+
+// ****************************************************************************************************
+// *    void CloneLoopHistos(GIFLoopHistos& from, GIFLoopHistos& to)
+//
+//  Fills the set of loop histograms to with empty accumulators having the binning of the ones of set
+//  from for every active partition of the infrastructure. The multiplicity counters of set to start
+//  empty.
+// ****************************************************************************************************
+
+void CloneLoopHistos(GIFLoopHistos& from, GIFLoopHistos& to){
+    Uint nPartitions = from.TimeProfile.size();
+
+    to = from;
+
+    for (Uint i = 0; i < nPartitions; i++){
+        to.TimeProfile.rpc[i].Reset();
+        to.HitProfile.rpc[i].Reset();
+        to.HitMultiplicity.rpc[i] = MultCounter();
+        to.TimeVSChanProfile.rpc[i].Reset();
+        to.StripNoiseProfile.rpc[i].Reset();
+        to.NoiseCSize.rpc[i].Reset();
+        to.NoiseCMult.rpc[i] = MultCounter();
+        to.BeamProfile.rpc[i].Reset();
+        to.EfficiencyFake.rpc[i].Reset();
+        to.EfficiencyPeak.rpc[i].Reset();
+        to.PeakCSize.rpc[i].Reset();
+        to.PeakCMult.rpc[i] = MultCounter();
+    }
+}
+
+// ****************************************************************************************************
+// *    void MergeLoopHistos(GIFLoopHistos& into, GIFLoopHistos& from)
+//
+//  Adds the content of the set of loop histograms from to the set into.
+// ****************************************************************************************************
+
+void MergeLoopHistos(GIFLoopHistos& into, GIFLoopHistos& from){
+    Uint nPartitions = into.TimeProfile.size();
+
+    for (Uint i = 0; i < nPartitions; i++){
+        into.TimeProfile.rpc[i].Add(from.TimeProfile.rpc[i]);
+        into.HitProfile.rpc[i].Add(from.HitProfile.rpc[i]);
+        into.HitMultiplicity.rpc[i].Add(from.HitMultiplicity.rpc[i]);
+        into.TimeVSChanProfile.rpc[i].Add(from.TimeVSChanProfile.rpc[i]);
+        into.StripNoiseProfile.rpc[i].Add(from.StripNoiseProfile.rpc[i]);
+        into.NoiseCSize.rpc[i].Add(from.NoiseCSize.rpc[i]);
+        into.NoiseCMult.rpc[i].Add(from.NoiseCMult.rpc[i]);
+        into.BeamProfile.rpc[i].Add(from.BeamProfile.rpc[i]);
+        into.EfficiencyFake.rpc[i].Add(from.EfficiencyFake.rpc[i]);
+        into.EfficiencyPeak.rpc[i].Add(from.EfficiencyPeak.rpc[i]);
+        into.PeakCSize.rpc[i].Add(from.PeakCSize.rpc[i]);
+        into.PeakCMult.rpc[i].Add(from.PeakCMult.rpc[i]);
+    }
+}
+
+// ****************************************************************************************************
+// *    void SetTimeWindows(muonPeak& PeakTime, muonPeak& PeakWidth, GIFWindowArray& Windows)
+//
+//  Computes once for all the partitions the limits of the muon peak window (PeakTime +/- PeakWidth)
+//  and of the fake window used by the event loop of efficiency runs.
+// ****************************************************************************************************
+
+void SetTimeWindows(muonPeak& PeakTime, muonPeak& PeakWidth, GIFWindowArray& Windows){
+    Windows.rpc.resize(PeakTime.size());
+
+    for(Uint i = 0; i < PeakTime.size(); i++){
+        //First define the accepted peak time range for efficiency calculation
+        Windows.rpc[i].PeakLow = PeakTime.rpc[i] - PeakWidth.rpc[i];
+        Windows.rpc[i].PeakHigh = PeakTime.rpc[i] + PeakWidth.rpc[i];
+
+        //Then define the accepted time range for fake efficiency calculation
+        //that should be probed in a window as wide as the peak window but
+        //uncorrelated with the trigger to measure the coincidence of noise
+        //with the muon hits. The window stops at the end of the total time
+        //window.
+        Windows.rpc[i].FakeLow = BMTDCWINDOW - (Windows.rpc[i].PeakHigh-Windows.rpc[i].PeakLow);
+    }
+}
+
+// ****************************************************************************************************
+// *    template <RunMode Mode>
+// *    void FillHit(Uint i, Uint strip, float time, GIFLoopHistos& H, GIFWindowArray& Windows,
+// *                 PartitionTable* Parts, HitArena& Arena)
+//
+//  Fills the profiles of the partition of dense index i with a hit of the event and stages the hit
+//  into the arena if it is not rejected.
+// ****************************************************************************************************
+
+template <RunMode Mode>
+inline void FillHit(Uint i, Uint strip, float time, GIFLoopHistos& H, GIFWindowArray& Windows,
+                    PartitionTable* Parts, HitArena& Arena){
+    //Bin of the strip in the strip profiles of the partition
+    int s = strip - Parts->GetInfo(i).FirstStrip + 1;
+
+    //Fill the time and hit profiles
+    H.TimeProfile.rpc[i].Fill(time);
+    H.HitProfile.rpc[i].FillBin(s,strip);
+    H.TimeVSChanProfile.rpc[i].FillBinX(s,strip,time);
+
+    //Reject the 100 first ns due to inhomogeneity of data
+    if(time >= TIMEREJECT){
+        if(Mode == EFFICIENCY){
+            const TimeWindow& window = Windows.rpc[i];
+
+            bool peakrange = (time >= window.PeakLow && time < window.PeakHigh);
+
+            //Fill the hits inside of the defined peak and noise range
+            if(peakrange)
+                H.BeamProfile.rpc[i].FillBin(s,strip);
+            else
+                H.StripNoiseProfile.rpc[i].FillBin(s,strip);
+
+            //Hits in the fake window
+            bool fakerange = (time >= window.FakeLow && time < BMTDCWINDOW);
+
+            Arena.Stage(i,s-1,time,peakrange,fakerange);
+        } else {
+            //Fill the hits inside of the defined noise range
+            H.StripNoiseProfile.rpc[i].FillBin(s,strip);
+            Arena.Stage(i,s-1,time,false,false);
+        }
+    }
+}
+
+// ****************************************************************************************************
+// *    template <RunMode Mode>
+// *    void FillClusters(GIFLoopHistos& H, PartitionTable* Parts, HitArena& Arena,
+// *                      ClusterBuilder& Builder)
+//
+//  Once all the hits of the event are staged, builds the clusters of every partition and fills the
+//  multiplicity, cluster and efficiency histograms.
+// ****************************************************************************************************
+
+template <RunMode Mode>
+void FillClusters(GIFLoopHistos& H, PartitionTable* Parts, HitArena& Arena, ClusterBuilder& Builder){
+    //Place the hits of each partition next to each other
+    Arena.Scatter();
+    const HitStore& Hits = Arena.GetHits();
+
+    for(Uint i = 0; i < Parts->GetNPartitions(); i++){
+        const PartitionInfo& part = Parts->GetInfo(i);
+        Uint Multiplicity = Arena.GetNHits(i);
+
+        //Clusterize noise/gamma data (the hits are ordered in time
+        //inside of the clusterization)
+        Builder.Clusterize(Hits,Arena.GetFirstNoise(i),Arena.GetLastNoise(i),part.nStrips,
+                           H.NoiseCSize.rpc[i],H.NoiseCMult.rpc[i]);
+
+        //Clusterize muon data and fill efficiency histograms based on
+        //the content of peak and fake hit vectors if efficiency run
+        if(Mode == EFFICIENCY){
+            //Peak data
+            Builder.Clusterize(Hits,Arena.GetFirstPeak(i),Arena.GetFirstNoise(i),part.nStrips,
+                               H.PeakCSize.rpc[i],H.PeakCMult.rpc[i]);
+
+            if(Arena.GetNPeak(i) > 0)
+                H.EfficiencyPeak.rpc[i].Fill(DETECTED);
+            else
+                H.EfficiencyPeak.rpc[i].Fill(MISSED);
+
+            //Fake data
+            if(Arena.GetNFake(i) > 0)
+                H.EfficiencyFake.rpc[i].Fill(DETECTED);
+            else
+                H.EfficiencyFake.rpc[i].Fill(MISSED);
+        }
+
+        //Save the hit multiplicity
+        H.HitMultiplicity.rpc[i].Fill(Multiplicity);
+    }
+}
+
+// ****************************************************************************************************
+// *    template <RunMode Mode>
+// *    void ProcessEvent(int qflag, Uint nHits, Uint* TDCCh, float* TDCTS, GIFLoopHistos& H,
+// *                      GIFWindowArray& Windows, DecodeTable* Decoder, PartitionTable* Parts,
+// *                      HitArena& Arena, ClusterBuilder& Builder)
+//
+//  Assigns the nHits hits of an event to the RPC partitions, builds the clusters and fills the loop
+//  histograms H. Several events can be processed in parallel as long as each call gets its own
+//  histogram set, hit arena and cluster builder. The function is compiled separately for each run
+//  mode so that the rate runs don't go through any of the muon peak and fake window code.
+// ****************************************************************************************************
+
+template <RunMode Mode>
+void ProcessEvent(int qflag, Uint nHits, Uint* TDCCh, float* TDCTS, GIFLoopHistos& H,
+                  GIFWindowArray& Windows, DecodeTable* Decoder, PartitionTable* Parts,
+                  HitArena& Arena, ClusterBuilder& Builder){
+    //The arena collects the hits of every partition and keeps
+    //the hits in peak window (for muons), the noise/gamma hits
+    //and count the hits in the fake window (window as wide as
+    //the peak window but uncorrelated) used to count the number
+    //of fake events in the peak region. The count of all hits
+    //kept in a partition is used to compute the noise rate.
+    Arena.Clear();
+
+    //Get quality flag in case of new format file
+    //and discard events with corrupted data.
+    if(!IsCorruptedEvent(qflag)){
+
+        //Loop over the TDC hits
+        for(Uint h = 0; h < nHits; h++){
+            const ChannelCode& code = Decoder->Decode(TDCCh[h]);
+
+            //Get rid of the hits in channels not considered in the mapping
+            if(code.Partition != NOCHANNELLINK)
+                FillHit<Mode>(code.Index,code.Strip,TDCTS[h],H,Windows,Parts,Arena);
+        }
+
+        //********** MULTIPLICITY AND CLUSTERS ***********************
+
+        FillClusters<Mode>(H,Parts,Arena,Builder);
+    }
+}
+
+// ****************************************************************************************************
+// *    template <RunMode Mode>
+// *    void ProcessCachedEvent(const HitCache& Cache, Uint entry, GIFLoopHistos& H,
+// *                            GIFWindowArray& Windows, PartitionTable* Parts,
+// *                            HitArena& Arena, ClusterBuilder& Builder)
+//
+//  Same as ProcessEvent(...) for an entry of the hit cache. The hits are read in place and are
+//  already decoded.
+// ****************************************************************************************************
+
+template <RunMode Mode>
+void ProcessCachedEvent(const HitCache& Cache, Uint entry, GIFLoopHistos& H,
+                        GIFWindowArray& Windows, PartitionTable* Parts,
+                        HitArena& Arena, ClusterBuilder& Builder){
+    Arena.Clear();
+
+    if(!Cache.IsCorrupted(entry)){
+        Uint last = Cache.GetFirstHit(entry+1);
+
+        for(Uint h = Cache.GetFirstHit(entry); h < last; h++)
+            FillHit<Mode>(Cache.GetIndex(h),Cache.GetStrip(h),Cache.GetTime(h),H,Windows,Parts,Arena);
+
+        FillClusters<Mode>(H,Parts,Arena,Builder);
+    }
+}
+
+// ****************************************************************************************************
+// *    void ProcessEntries(TTree* dataTree, Uint first, Uint last, GIFLoopHistos& H,
+// *                        GIFWindowArray& Windows, RunMode Mode, bool isNewFormat,
+// *                        DecodeTable* Decoder, PartitionTable* Parts)
+//
+//  Loops over the entries [first,last[ of the RAWData tree and processes them one by one. Several
+//  calls on different entry ranges can run in parallel as long as each of them gets its own tree.
+// ****************************************************************************************************
+
+void ProcessEntries(TTree* dataTree, Uint first, Uint last, GIFLoopHistos& H,
+                    GIFWindowArray& Windows, RunMode Mode, bool isNewFormat,
+                    DecodeTable* Decoder, PartitionTable* Parts){
+
+    //****************** LINK RAW DATA *******************************
+
+    RAWData data;
+
+    data.QFlag = GOOD;
+    data.TDCCh = new vector<Uint>;
+    data.TDCTS = new vector<float>;
+    data.TDCCh->clear();
+    data.TDCTS->clear();
+
+    dataTree->SetBranchAddress("TDC_channel",    &data.TDCCh);
+    dataTree->SetBranchAddress("TDC_TimeStamp",  &data.TDCTS);
+
+    if(isNewFormat)
+        dataTree->SetBranchAddress("Quality_flag", &data.QFlag);
+
+    HitArena Arena(Decoder->GetNPartitions());
+    ClusterBuilder Builder;
+
+    for(Uint i = first; i < last; i++){
+        dataTree->GetEntry(i);
+
+        if(Mode == EFFICIENCY)
+            ProcessEvent<EFFICIENCY>(data.QFlag,data.TDCCh->size(),data.TDCCh->data(),data.TDCTS->data(),
+                                     H,Windows,Decoder,Parts,Arena,Builder);
+        else
+            ProcessEvent<RATE>(data.QFlag,data.TDCCh->size(),data.TDCCh->data(),data.TDCTS->data(),
+                               H,Windows,Decoder,Parts,Arena,Builder);
+    }
+
+    dataTree->ResetBranchAddresses();
+    delete data.TDCCh;
+    delete data.TDCTS;
+}
+
+// ****************************************************************************************************
+// *    void ReplayBuffer(RAWDataBuffer& buffer, Uint first, Uint last, GIFLoopHistos& H,
+// *                      GIFWindowArray& Windows, RunMode Mode, DecodeTable* Decoder,
+// *                      PartitionTable* Parts, HitArena& Arena, ClusterBuilder& Builder)
+//
+//  Processes the entries [first,last[ of buffer using the hit arena and cluster builder of the
+//  caller.
+// ****************************************************************************************************
+
+void ReplayBuffer(RAWDataBuffer& buffer, Uint first, Uint last, GIFLoopHistos& H,
+                  GIFWindowArray& Windows, RunMode Mode, DecodeTable* Decoder,
+                  PartitionTable* Parts, HitArena& Arena, ClusterBuilder& Builder){
+    for(Uint i = first; i < last; i++){
+        Uint offset = buffer.EntryOffset[i];
+        Uint nHits = buffer.EntryOffset[i+1] - offset;
+
+        if(Mode == EFFICIENCY)
+            ProcessEvent<EFFICIENCY>(buffer.QFlag[i],nHits,buffer.TDCCh.data()+offset,buffer.TDCTS.data()+offset,
+                                     H,Windows,Decoder,Parts,Arena,Builder);
+        else
+            ProcessEvent<RATE>(buffer.QFlag[i],nHits,buffer.TDCCh.data()+offset,buffer.TDCTS.data()+offset,
+                               H,Windows,Decoder,Parts,Arena,Builder);
+    }
+}
+
+// ****************************************************************************************************
+// *    void ProcessBuffer(RAWDataBuffer& buffer, Uint first, Uint last, GIFLoopHistos& H,
+// *                       GIFWindowArray& Windows, RunMode Mode, DecodeTable* Decoder,
+// *                       PartitionTable* Parts)
+//
+//  Same as ProcessEntries(...) but replaying the entries [first,last[ previously loaded into memory
+//  with ReadRAWData(...). The buffer is only read, so it can be shared by parallel calls.
+// ****************************************************************************************************
+
+void ProcessBuffer(RAWDataBuffer& buffer, Uint first, Uint last, GIFLoopHistos& H,
+                   GIFWindowArray& Windows, RunMode Mode, DecodeTable* Decoder,
+                   PartitionTable* Parts){
+    HitArena Arena(Decoder->GetNPartitions());
+    ClusterBuilder Builder;
+
+    ReplayBuffer(buffer,first,last,H,Windows,Mode,Decoder,Parts,Arena,Builder);
+}
+
+// ****************************************************************************************************
+// *    void ProcessCache(HitCache& Cache, Uint first, Uint last, GIFLoopHistos& H,
+// *                      GIFWindowArray& Windows, RunMode Mode, DecodeTable* Decoder,
+// *                      PartitionTable* Parts)
+//
+//  Same as ProcessEntries(...) but reading the entries [first,last[ from the hit cache of the DAQ
+//  file. The cache is only read, so it can be shared by parallel calls.
+// ****************************************************************************************************
+
+void ProcessCache(HitCache& Cache, Uint first, Uint last, GIFLoopHistos& H,
+                  GIFWindowArray& Windows, RunMode Mode, DecodeTable* Decoder,
+                  PartitionTable* Parts){
+    HitArena Arena(Decoder->GetNPartitions());
+    ClusterBuilder Builder;
+
+    for(Uint i = first; i < last; i++){
+        if(Mode == EFFICIENCY)
+            ProcessCachedEvent<EFFICIENCY>(Cache,i,H,Windows,Parts,Arena,Builder);
+        else
+            ProcessCachedEvent<RATE>(Cache,i,H,Windows,Parts,Arena,Builder);
+    }
+}
+
+// ****************************************************************************************************
+// *    void ConsumeChunks(ChunkRing& Ring, GIFLoopHistos& H, GIFWindowArray& Windows, RunMode Mode,
+// *                       DecodeTable* Decoder, PartitionTable* Parts)
+//
+//  Analysis thread of the pipelined loop. Processes the chunks of entries given through Ring by the
+//  reader until the ring is closed and empty. The hit arena and the cluster builder are kept from
+//  one chunk to the next.
+// ****************************************************************************************************
+
+void ConsumeChunks(ChunkRing& Ring, GIFLoopHistos& H, GIFWindowArray& Windows, RunMode Mode,
+                   DecodeTable* Decoder, PartitionTable* Parts){
+    HitArena Arena(Decoder->GetNPartitions());
+    ClusterBuilder Builder;
+
+    while(true){
+        //Sleeps while the reader is behind, NULL once all the chunks
+        //of the ring were analysed
+        RAWDataBuffer* chunk = Ring.WaitReadSlot();
+        if(chunk == NULL) break;
+
+        ReplayBuffer(*chunk,0,chunk->QFlag.size(),H,Windows,Mode,Decoder,Parts,Arena,Builder);
+        Ring.Pop();
+    }
+}
+
+// ****************************************************************************************************
+// *    void ProcessPipeline(TTree* dataTree, Uint first, Uint last, vector<GIFLoopHistos>& WorkerH,
+// *                         GIFWindowArray& Windows, RunMode Mode, bool isNewFormat,
+// *                         DecodeTable* Decoder, PartitionTable* Parts, Uint depth)
+//
+//  Pipelined loop over the entries [first,last[ of the RAWData tree. The calling thread reads the
+//  entries (I/O, decompression and unpacking of the vectors) ahead into chunks while one analysis
+//  thread per set of loop histograms of WorkerH decodes, clusterizes and fills them. Each analysis
+//  thread gets its own ring of depth chunks.
+// ****************************************************************************************************
+
+void ProcessPipeline(TTree* dataTree, Uint first, Uint last, vector<GIFLoopHistos>& WorkerH,
+                     GIFWindowArray& Windows, RunMode Mode, bool isNewFormat,
+                     DecodeTable* Decoder, PartitionTable* Parts, Uint depth){
+    Uint nWorkers = WorkerH.size();
+
+    vector<ChunkRing*> Rings;
+    vector<thread> Workers;
+
+    for(Uint w = 0; w < nWorkers; w++)
+        Rings.push_back(new ChunkRing(depth));
+
+    for(Uint w = 0; w < nWorkers; w++)
+        Workers.push_back(thread(ConsumeChunks,ref(*Rings[w]),ref(WorkerH[w]),ref(Windows),
+                                 Mode,Decoder,Parts));
+
+    ReadChunks(dataTree,first,last,isNewFormat,Rings);
+
+    for(Uint w = 0; w < nWorkers; w++){
+        Workers[w].join();
+        delete Rings[w];
+    }
+}
+
+// ****************************************************************************************************
+// *    void SplitEntries(Uint first, Uint last, Uint nWorkers, const vector<Uint>& FileOffset,
+// *                      vector<EntryRange>& Ranges)
+//
+//  Splits the entries [first,last[ of a run into the entry ranges of nWorkers threads. FileOffset
+//  gives the first entry of each DAQ file of the run followed by the total number of entries. Each
+//  file overlapping [first,last[ gets at least one thread and the threads are shared among the
+//  files, each file being split into contiguous ranges of the same size. The ranges are given
+//  following the order of the entries.
+// ****************************************************************************************************
+
+void SplitEntries(Uint first, Uint last, Uint nWorkers, const vector<Uint>& FileOffset,
+                  vector<EntryRange>& Ranges){
+    Ranges.clear();
+
+    vector<Uint> Files;
+
+    for(Uint f = 0; f+1 < FileOffset.size(); f++)
+        if(FileOffset[f] < last && FileOffset[f+1] > first) Files.push_back(f);
+
+    Uint nFiles = Files.size();
+    if(nFiles == 0) return;
+
+    if(nWorkers < nFiles) nWorkers = nFiles;
+
+    for(Uint i = 0; i < nFiles; i++){
+        Uint f = Files[i];
+        Uint fileFirst = max(first,FileOffset[f]);
+        Uint fileLast = min(last,FileOffset[f+1]);
+        Uint nFileEntries = fileLast - fileFirst;
+
+        Uint nPieces = nWorkers/nFiles + ((i < nWorkers%nFiles) ? 1 : 0);
+        if(nPieces > nFileEntries) nPieces = nFileEntries;
+
+        for(Uint w = 0; w < nPieces; w++){
+            EntryRange range;
+            range.File = f;
+            range.First = fileFirst + (Uint)((unsigned long long)nFileEntries*w/nPieces);
+            range.Last  = fileFirst + (Uint)((unsigned long long)nFileEntries*(w+1)/nPieces);
+            Ranges.push_back(range);
+        }
+    }
+}
+
+// ****************************************************************************************************
+// *    void LoadSetup(string scanDir, AnalysisSetup& setup)
+//
+//  Reads the geometry (Dimensions.ini) and the mapping (ChannelsMapping.csv) of the scan directory
+//  scanDir and builds the partition and decoding tables out of them.
+// ****************************************************************************************************
+
+void LoadSetup(string scanDir, AnalysisSetup& setup){
+    //****************** GEOMETRY ************************************
+
+    //Get the chambers geometry and the GIF infrastructure details
+    setup.DimPath = scanDir + __dimension;
+    setup.Dimensions = new IniFile(setup.DimPath);
+    setup.Dimensions->Read();
+
+    setup.GIFInfra = new Infrastructure(setup.Dimensions);
+
+    //Number the active partitions and keep their names and geometry
+    setup.Parts = new PartitionTable(setup.GIFInfra);
+
+    //****************** MAPPING *************************************
+
+    //Get the channels mapping as well as the mask
+    setup.MapPath = scanDir + __mapping;
+    setup.RPCChMap = new Mapping(setup.MapPath);
+    setup.RPCChMap->Read();
+
+    //Decode once for all the TDC channels into trolley, slot,
+    //partition and strip for the loops over the hits
+    setup.Decoder = new DecodeTable(setup.RPCChMap,setup.Parts);
+}
+
+// ****************************************************************************************************
+// *    void DeleteSetup(AnalysisSetup& setup)
+//
+//  Frees the tables built by LoadSetup(...).
+// ****************************************************************************************************
+
+void DeleteSetup(AnalysisSetup& setup){
+    delete setup.Decoder;
+    delete setup.RPCChMap;
+    delete setup.Parts;
+    delete setup.GIFInfra;
+    delete setup.Dimensions;
+}
+
+// ****************************************************************************************************
+// *    void WriteOutput(string scanDir, AnalysisOutput& output)
+//
+//  Writes the CSV headers of a HV step into the scan directory scanDir and appends its rows to the
+//  CSV files of the scan.
+// ****************************************************************************************************
+
+void WriteOutput(string scanDir, AnalysisOutput& output){
+    ofstream headRateCSV((scanDir + "/Offline-Rate-Header.csv").c_str(),ios::out);
+    headRateCSV << output.HeadRate;
+    headRateCSV.close();
+
+    ofstream outputRateCSV((scanDir + "/Offline-Rate.csv").c_str(),ios::app);
+    outputRateCSV << output.RowRate;
+    outputRateCSV.close();
+
+    ofstream headCorrCSV((scanDir + "/Offline-Corrupted-Header.csv").c_str(),ios::out);
+    headCorrCSV << output.HeadCorr;
+    headCorrCSV.close();
+
+    ofstream outputCorrCSV((scanDir + "/Offline-Corrupted.csv").c_str(),ios::app);
+    outputCorrCSV << output.RowCorr;
+    outputCorrCSV.close();
+
+    ofstream headEffCSV((scanDir + "/Offline-L0-EffCl-Header.csv").c_str(),ios::out);
+    headEffCSV << output.HeadEff;
+    headEffCSV.close();
+
+    ofstream outputEffCSV((scanDir + "/Offline-L0-EffCl.csv").c_str(),ios::app);
+    outputEffCSV << output.RowEff;
+    outputEffCSV.close();
+}
+
+// ****************************************************************************************************
+// *    void OfflineAnalysis(string baseName, AnalysisOptions& options)
+//
+//  Analyses the content of baseName_DAQ.root and writes the results into baseName_Offline.root and
+//  into the CSV files of the scan directory. The loop over the entries is split over the number of
+//  threads given in the options.
+// ****************************************************************************************************
+
+void OfflineAnalysis(string baseName, AnalysisOptions& options){
+    string scanDir = baseName.substr(0,baseName.find_last_of("/"));
+
+    //The histograms booked by the analysis are not attached to the
+    //current directory. They are written explicitly and deleted at the
+    //end instead of being kept alive by the files until they close.
+    bool addDirectory = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(false);
+
+    AnalysisSetup setup;
+    LoadSetup(scanDir,setup);
+
+    AnalysisOutput output;
+
+    if(AnalyseStep(baseName,options,setup,output))
+        WriteOutput(scanDir,output);
+
+    DeleteSetup(setup);
+
+    TH1::AddDirectory(addDirectory);
+}
+
+// ****************************************************************************************************
+// *    bool RunLoop(string baseName, AnalysisOptions& options, AnalysisSetup& setup,
+// *                 Uint firstEntry, Uint lastEntry, LoopResults& R)
+//
+//  Opens the DAQ files of the run baseName (baseName_DAQ.root and its parts baseName_DAQ_N.root),
+//  looks for the muon peak of efficiency runs on all their entries and loops over the entries
+//  [firstEntry,lastEntry[ of the run (cut to the number of entries of the run) to fill the loop
+//  histograms. When only a part of the run is looped over, the muon peak is taken from the peak file
+//  baseName_Peak.raw, or searched and saved into it for the other parts. Everything the rest of the
+//  analysis needs is saved into R. Returns false if the DAQ files couldn't be opened.
+// ****************************************************************************************************
+
+bool RunLoop(string baseName, AnalysisOptions& options, AnalysisSetup& setup,
+             Uint firstEntry, Uint lastEntry, LoopResults& R){
 
-    string daqName = baseName + "_DAQ.root";
+    vector<string> DAQFiles;
+    FindDAQFiles(baseName,DAQFiles);
+
+    string daqName = DAQFiles.empty() ? baseName + "_DAQ.root" : DAQFiles[0];
 
     //****************** DAQ ROOT FILE *******************************
 
-    //input ROOT data file containing the RAWData TTree that we'll
-    //link to our RAWData structure
+    //input ROOT data file containing the RunParameters TTree. The
+    //RAWData TTrees of all the DAQ files of the run are chained and
+    //linked to our RAWData structure
     TFile   dataFile(daqName.c_str());
 
     if(dataFile.IsOpen()){
-        TTree*  dataTree = (TTree*)dataFile.Get("RAWData");
+        TChain* dataTree = new TChain("RAWData");
+        Uint nFiles = DAQFiles.size();
+
+        for(Uint f = 0; f < nFiles; f++)
+            dataTree->Add(DAQFiles[f].c_str());
+
+        //First entry of each DAQ file in the chain
+        vector<Uint> FileOffset(nFiles+1,0);
+        R.nFileEntries = dataTree->GetEntries();
+
+        for(Uint f = 0; f < nFiles; f++)
+            FileOffset[f] = dataTree->GetTreeOffset()[f];
+        FileOffset[nFiles] = R.nFileEntries;
+
+        dataTree->LoadTree(0);
+
+        if(nFiles > 1)
+            MSG_INFO("[Analysis] Run split over " + intToString(nFiles) + " DAQ files");
 
         //Check if we are about to analyse an old format file or a new one
         //The newest files contain an extra branch called "Quality_flag"
         //that helps on rejecting any corrupted data.
         bool isNewFormat = dataTree->GetListOfBranches()->Contains("Quality_flag");
 
-        //Then get the HVstep number from the ID histogram
-        string HVstep = baseName.substr(baseName.find_last_of("_HV")+1);
+        //Only read the branches needed by the analysis
+        SetTreeReading(dataTree,isNewFormat,0,R.nFileEntries,options.CacheSizeMB);
 
-        //****************** GEOMETRY ************************************
+        //****************** GEOMETRY & MAPPING **************************
 
-        //Get the chambers geometry and the GIF infrastructure details
-        string dimpath = daqName.substr(0,daqName.find_last_of("/")) + __dimension;
-        IniFile* Dimensions = new IniFile(dimpath);
-        Dimensions->Read();
-
-        Infrastructure* GIFInfra = new Infrastructure(Dimensions);
-
-        //****************** MAPPING *************************************
-
-        //Get the channels mapping as well as the mask
-        string mappath = daqName.substr(0,daqName.find_last_of("/")) + __mapping;
-        Mapping* RPCChMap = new Mapping(mappath);
-        RPCChMap->Read();
+        //The geometry, the mapping and the tables built out of them are
+        //shared by all the HV steps of the scan
+        PartitionTable* Parts = setup.Parts;
+        DecodeTable* Decoder = setup.Decoder;
+        Uint nPartitions = Parts->GetNPartitions();
 
         //****************** PEAK TIME ***********************************
 
@@ -96,889 +765,1046 @@ void OfflineAnalysis(string baseName){
         RunParameters->SetBranchAddress("RunType",&RunType);
         RunParameters->GetEntry(0);
 
-        muonPeak PeakHeight = {{{0.}}};
-        muonPeak PeakTime = {{{0.}}};
-        muonPeak PeakWidth = {{{0.}}};
+        //The run type is resolved once for all
+        RunMode Mode = IsEfficiencyRun(RunType) ? EFFICIENCY : RATE;
 
-        if(IsEfficiencyRun(RunType))
-            SetBeamWindow(PeakHeight,PeakTime,PeakWidth,dataTree,RPCChMap,GIFInfra);
+        RunParameters->ResetBranchAddresses();
+        delete RunType;
 
-        //****************** LINK RAW DATA *******************************
+        R.Mode = Mode;
+        R.isNewFormat = isNewFormat;
+        R.PeakHeight = muonPeak(nPartitions,0.);
+        R.PeakTime = muonPeak(nPartitions,0.);
+        R.PeakWidth = muonPeak(nPartitions,0.);
 
-        RAWData data;
+        muonPeak& PeakHeight = R.PeakHeight;
+        muonPeak& PeakTime = R.PeakTime;
+        muonPeak& PeakWidth = R.PeakWidth;
 
-        data.TDCCh = new vector<Uint>;
-        data.TDCTS = new vector<float>;
-        data.TDCCh->clear();
-        data.TDCTS->clear();
+        //****************** HIT CACHE *************************************
 
-        dataTree->SetBranchAddress("EventNumber",    &data.iEvent);
-        dataTree->SetBranchAddress("number_of_hits", &data.TDCNHits);
-        dataTree->SetBranchAddress("TDC_channel",    &data.TDCCh);
-        dataTree->SetBranchAddress("TDC_TimeStamp",  &data.TDCTS);
+        //When the DAQ file was already converted into a compact hit cache
+        //with the same mapping and geometry, the hits are read from the
+        //cache instead of the ROOT file. The cache is made on demand.
+        string cacheName = baseName + __hitcache;
+        HitCacheKeys CacheKeys;
+        GetHitCacheKeys(DAQFiles,setup.MapPath,setup.DimPath,R.nFileEntries,nPartitions,CacheKeys);
 
-        if(isNewFormat)
-            dataTree->SetBranchAddress("Quality_flag", &data.QFlag);
+        //The checkpoints and the peak file identify the DAQ files in a
+        //way that survives a copy to another machine
+        HitCacheKeys PartialKeys;
+        GetPartialKeys(DAQFiles,setup.MapPath,setup.DimPath,R.nFileEntries,nPartitions,PartialKeys);
 
-        //****************** HISTOGRAMS & CANVAS *************************
+        //Only the entries [firstEntry,lastEntry[ are analysed while the
+        //muon peak is always the one of the whole run
+        if(lastEntry > R.nFileEntries) lastEntry = R.nFileEntries;
+        if(firstEntry > lastEntry) firstEntry = lastEntry;
 
-        GIFH1Array TimeProfile_H;
-        GIFH1Array HitProfile_H;
-        GIFH1Array HitMultiplicity_H;
-        GIFH2Array TimeVSChanProfile_H;
-
-        GIFH1Array StripNoiseProfile_H;
-        GIFH1Array StripActivity_H;
-        GIFH1Array StripHomogeneity_H;
-        GIFH1Array MaskNoiseProfile_H;
-        GIFH1Array MaskActivity_H;
-        GIFH1Array NoiseCSize_H;
-        GIFH1Array NoiseCMult_H;
-
-        GIFH1Array ChipMeanNoiseProf_H;
-        GIFH1Array ChipActivity_H;
-        GIFH1Array ChipHomogeneity_H;
-
-        GIFH1Array BeamProfile_H;
-        GIFH1Array EfficiencyFake_H;
-        GIFH1Array EfficiencyPeak_H;
-        GIFH1Array PeakCSize_H;
-        GIFH1Array PeakCMult_H;
-        GIFH1Array Efficiency0_H;
-        GIFH1Array MuonCSize_H;
-        GIFH1Array MuonCMult_H;
-
-        char hisname[50];  //ID name of the histogram
-        char histitle[50]; //Title of the histogram
-
-        //Set a table to get the ranges of different multiplicity
-        //histograms in an almost dynamical way (range is adapted
-        //every time the multiplicity value goes beyond the actual
-        //range). This variable will also be used to later know the
-        //fitting range of multiplicity histograms.
-        GIFnBinsMult nBinsMult;
-
-        for (Uint tr = 0; tr < GIFInfra->GetNTrolleys(); tr++){
-            Uint T = GIFInfra->GetTrolleyID(tr);
-
-            for (Uint sl = 0; sl < GIFInfra->GetNSlots(tr); sl++){
-                Uint S = GIFInfra->GetSlotID(tr,sl) - 1;
-
-                //Get the chamber ID name
-                string rpcID = GIFInfra->GetName(tr,sl);
-
-                for (Uint p = 0; p < GIFInfra->GetNPartitions(tr,sl); p++){
-                    //Set bining
-                    Uint nStrips = GIFInfra->GetNStrips(tr,sl);
-                    float low_s = nStrips*p + 0.5;
-                    float high_s = nStrips*(p+1) + 0.5;
-
-                    //Initialise the number of bins to 10 for multiplicity histograms
-                    nBinsMult.rpc[T][S][p] = 10;
-                    float lowBin = -0.5;
-                    float highBin = (float)nBinsMult.rpc[T][S][p] + lowBin;
-
-                    //Time profile binning
-                    float timeWidth = 1.;
-
-                    if(IsEfficiencyRun(RunType))
-                        timeWidth = BMTDCWINDOW;
-                    else
-                        timeWidth = RDMTDCWINDOW;
-
-                    //Initialisation of the histograms
-
-                    //****************************************** General histograms
-
-                    //Time profile
-                    SetTitleName(rpcID,p,hisname,histitle,"Time_Profile","Time profile");
-                    TimeProfile_H.rpc[T][S][p] = new TH1F(hisname, histitle, (int)timeWidth/TIMEBIN, 0., timeWidth);
-                    SetTH1(TimeProfile_H.rpc[T][S][p],"Time (ns)","Number of hits");
-
-                    //Hit profile
-                    SetTitleName(rpcID,p,hisname,histitle,"Hit_Profile","Hit profile");
-                    HitProfile_H.rpc[T][S][p] = new TH1I(hisname, histitle, nStrips, low_s, high_s);
-                    SetTH1(HitProfile_H.rpc[T][S][p],"Strip","Number of events");
-
-                    //Hit multiplicity
-                    SetTitleName(rpcID,p,hisname,histitle,"Hit_Multiplicity","Hit multiplicity");
-                    HitMultiplicity_H.rpc[T][S][p] = new TH1I(hisname, histitle, nBinsMult.rpc[T][S][p], lowBin, highBin);
-                    SetTH1(HitMultiplicity_H.rpc[T][S][p],"Multiplicity","Number of events");
-
-                    //2D Time vs hit profile
-                    SetTitleName(rpcID,p,hisname,histitle,"Time_vs_Strip_Profile","Time vs Strip 2D profile");
-                    TimeVSChanProfile_H.rpc[T][S][p] = new TH2F(hisname, histitle, nStrips, low_s, high_s, (int)timeWidth/TIMEBIN, 0., timeWidth);
-                    TimeVSChanProfile_H.rpc[T][S][p]->SetOption("COLZ");
-                    SetTH2(TimeVSChanProfile_H.rpc[T][S][p],"Strip","Time (ns)","Number of hits");
-
-                    //****************************************** Strip granularuty level histograms
-
-                    //Mean noise/gamma rate profile
-                    SetTitleName(rpcID,p,hisname,histitle,"Strip_Mean_Noise","Strip mean noise rate");
-                    StripNoiseProfile_H.rpc[T][S][p] = new TH1F(hisname, histitle, nStrips, low_s, high_s);
-                    SetTH1(StripNoiseProfile_H.rpc[T][S][p],"Strip","Rate (Hz/cm^{2})");
-
-                    //Strip activity
-                    SetTitleName(rpcID,p,hisname,histitle,"Strip_Activity","Strip activity");
-                    StripActivity_H.rpc[T][S][p] = new TH1F(hisname, histitle, nStrips, low_s, high_s);
-                    SetTH1(StripActivity_H.rpc[T][S][p],"Strip","Activity (normalized strip profil)");
-
-                    //Noise/gamma homogeneity
-                    SetTitleName(rpcID,p,hisname,histitle,"Strip_Homogeneity","Strip homogeneity");
-                    StripHomogeneity_H.rpc[T][S][p] = new TH1F(hisname, histitle, 1, 0, 1);
-                    StripHomogeneity_H.rpc[T][S][p]->SetOption("TEXT");
-                    SetTH1(StripHomogeneity_H.rpc[T][S][p],"","Homogeneity");
-
-                    //Masked strip mean noise/gamma rate profile
-                    SetTitleName(rpcID,p,hisname,histitle,"mask_Strip_Mean_Noise","Masked strip mean noise rate");
-                    MaskNoiseProfile_H.rpc[T][S][p] = new TH1F(hisname, histitle, nStrips, low_s, high_s);
-                    SetTH1(MaskNoiseProfile_H.rpc[T][S][p],"Strip","Rate (Hz/cm^{2})");
-
-                    //Masked strip activity
-                    SetTitleName(rpcID,p,hisname,histitle,"mask_Strip_Activity","Masked strip activity");
-                    MaskActivity_H.rpc[T][S][p] = new TH1F(hisname, histitle, nStrips, low_s, high_s);
-                    SetTH1(MaskActivity_H.rpc[T][S][p],"Strip","Activity (normalized strip profil)");
-
-                    //Noise/gamma cluster size
-                    SetTitleName(rpcID,p,hisname,histitle,"NoiseCSize_H","Noise/gamma cluster size");
-                    NoiseCSize_H.rpc[T][S][p] = new TH1I(hisname, histitle, nStrips, 0.5, nStrips+0.5);
-                    SetTH1(NoiseCSize_H.rpc[T][S][p],"Cluster size","Number of events");
-
-                    //Noise/gamma cluster multiplicity
-                    SetTitleName(rpcID,p,hisname,histitle,"NoiseCMult_H","Noise/gamma cluster multiplicity");
-                    NoiseCMult_H.rpc[T][S][p] = new TH1I(hisname, histitle,  nBinsMult.rpc[T][S][p], lowBin, highBin);
-                    SetTH1(NoiseCMult_H.rpc[T][S][p],"Cluster multiplicity","Number of events");
-
-                    //****************************************** Chip granularuty level histograms
-
-                    //Mean noise rate profile
-                    SetTitleName(rpcID,p,hisname,histitle,"Chip_Mean_Noise","Chip mean noise rate");
-                    ChipMeanNoiseProf_H.rpc[T][S][p] = new TH1F(hisname, histitle, nStrips/8, low_s, high_s);
-                    SetTH1(ChipMeanNoiseProf_H.rpc[T][S][p],"Chip","Rate (Hz/cm^{2})");
-
-                    //Strip activity
-                    SetTitleName(rpcID,p,hisname,histitle,"Chip_Activity","Chip activity");
-                    ChipActivity_H.rpc[T][S][p] = new TH1F(hisname, histitle, nStrips/8, low_s, high_s);
-                    SetTH1(ChipActivity_H.rpc[T][S][p],"Chip","Activity (normalized chip profil)");
-
-                    //Noise homogeneity
-                    SetTitleName(rpcID,p,hisname,histitle,"Chip_Homogeneity","Chip homogeneity");
-                    ChipHomogeneity_H.rpc[T][S][p] = new TH1F(hisname, histitle, 1, 0, 1);
-                    ChipHomogeneity_H.rpc[T][S][p]->SetOption("TEXT");
-                    SetTH1(ChipHomogeneity_H.rpc[T][S][p],"","Homogeneity");
-
-                    //****************************************** Muon histogram
-
-                    //Beam profile
-                    SetTitleName(rpcID,p,hisname,histitle,"Beam_Profile","Beam profile");
-                    BeamProfile_H.rpc[T][S][p] = new TH1I(hisname, histitle, nStrips, low_s, high_s);
-                    SetTH1(BeamProfile_H.rpc[T][S][p],"Strip","Number of hits");
-
-                    //Efficiency due to noise/background
-                    SetTitleName(rpcID,p,hisname,histitle,"Efficiency_Fake","Fake efficiency");
-                    EfficiencyFake_H.rpc[T][S][p] = new TH1I(hisname, histitle, 2, -0.5, 1.5);
-                    SetTH1(EfficiencyFake_H.rpc[T][S][p],"Is efficient?","Number of events");
-
-                    //Efficiency due to in time hits
-                    SetTitleName(rpcID,p,hisname,histitle,"Efficiency_Peak","Peak efficiency");
-                    EfficiencyPeak_H.rpc[T][S][p] = new TH1I(hisname, histitle, 2, -0.5, 1.5);
-                    SetTH1(EfficiencyPeak_H.rpc[T][S][p],"Is efficient?","Number of events");
-
-                    //Peak cluster Size
-                    SetTitleName(rpcID,p,hisname,histitle,"PeakCSize_H","Peak cluster size");
-                    PeakCSize_H.rpc[T][S][p] = new TH1I(hisname, histitle, nStrips, 0.5, nStrips+0.5);
-                    SetTH1(PeakCSize_H.rpc[T][S][p],"Cluster size","Number of events");
-
-                    //Peak cluster multiplicity
-                    SetTitleName(rpcID,p,hisname,histitle,"PeakCMult_H","Peak cluster multiplicity");
-                    PeakCMult_H.rpc[T][S][p] = new TH1I(hisname, histitle, nBinsMult.rpc[T][S][p], lowBin, highBin);
-                    SetTH1(PeakCMult_H.rpc[T][S][p],"Cluster multiplicity","Number of events");
-
-                    //Corrected muon efficiency
-                    SetTitleName(rpcID,p,hisname,histitle,"L0_Efficiency","L0 efficiency");
-                    Efficiency0_H.rpc[T][S][p] = new TH1F(hisname, histitle, 2, 0, 2);
-                    Efficiency0_H.rpc[T][S][p]->SetOption("TEXT");
-                    SetTH1(Efficiency0_H.rpc[T][S][p],"","");
-
-                    //Corrected muon cluster size
-                    SetTitleName(rpcID,p,hisname,histitle,"MuonCSize_H","Muon cluster size");
-                    MuonCSize_H.rpc[T][S][p] = new TH1F(hisname, histitle, 2, 0, 2);
-                    MuonCSize_H.rpc[T][S][p]->SetOption("TEXT");
-                    SetTH1(MuonCSize_H.rpc[T][S][p],"","");
-
-                    //Corrected muon multiplicity
-                    SetTitleName(rpcID,p,hisname,histitle,"MuonCMult_H","Muon cluster multiplicity");
-                    MuonCMult_H.rpc[T][S][p] = new TH1F(hisname, histitle, 2, 0, 2);
-                    MuonCMult_H.rpc[T][S][p]->SetOption("TEXT");
-                    SetTH1(MuonCMult_H.rpc[T][S][p],"","");
-                }
-            }
+        R.First = firstEntry;
+        R.Last = lastEntry;
+
+        //****************** CHECKPOINT ************************************
+
+        //A previous loop over the same entries that was interrupted is
+        //resumed from its last checkpoint if it was made with the same
+        //DAQ files, mapping and geometry. The muon peak parameters of
+        //the checkpoint are used instead of searching the peak again.
+        string checkpointName = GetCheckpointName(baseName,firstEntry,lastEntry);
+        Uint resumeEntry = firstEntry;
+        bool resumed = false;
+
+        if(options.CheckpointPeriod > 0 && ReadCheckpoint(checkpointName,PartialKeys,R)){
+            resumeEntry = R.Last;
+            resumed = true;
+
+            MSG_INFO("[Analysis] Loop resumed from entry " + longTostring(resumeEntry)
+                     + " (" + checkpointName + ")");
+        }
+
+        HitCache* Cache = new HitCache();
+        bool useCache = Cache->Open(cacheName,CacheKeys);
+        RAWDataBuffer DataBuffer;
+
+        if(!useCache && options.MakeHitCache){
+            ReadRAWFiles(DAQFiles,isNewFormat,options.CacheSizeMB,DataBuffer);
+
+            if(WriteHitCache(cacheName,DataBuffer,Decoder,CacheKeys))
+                useCache = Cache->Open(cacheName,CacheKeys);
+        }
+
+        if(useCache){
+            MSG_INFO("[Analysis] Hits read from " + cacheName);
+            DataBuffer = RAWDataBuffer();
+        }
+
+        bool findPeak = (Mode == EFFICIENCY) && !resumed;
+
+        //The loops over a part of the run share the muon peak searched
+        //once on the whole run through the peak file
+        bool wholeRun = (firstEntry == 0 && lastEntry == R.nFileEntries);
+        string peakName = baseName + __peakfile;
+
+        if(findPeak && !wholeRun && ReadPeakFile(peakName,PartialKeys,R)){
+            findPeak = false;
+            MSG_INFO("[Analysis] Muon peak read from " + peakName);
         }
 
+        //In single pass mode, the content of the DAQ files is loaded into
+        //memory once, each file by a thread of its own. Both the muon peak
+        //search and the analysis then replay the hits of all the files
+        //from memory instead of reading them twice.
+        //This is only useful when there is a muon peak to look for, and
+        //when the loop goes over all the entries that were loaded.
+        bool useBuffer = !useCache && ((options.SinglePass && findPeak && wholeRun)
+                                       || !DataBuffer.QFlag.empty());
+
+        if(useCache){
+            if(findPeak)
+                SetBeamWindow(PeakHeight,PeakTime,PeakWidth,*Cache,Parts);
+        } else if(useBuffer){
+            if(DataBuffer.QFlag.empty())
+                ReadRAWFiles(DAQFiles,isNewFormat,options.CacheSizeMB,DataBuffer);
+            if(findPeak)
+                SetBeamWindow(PeakHeight,PeakTime,PeakWidth,DataBuffer,Decoder,Parts);
+        } else if(findPeak)
+            SetBeamWindow(PeakHeight,PeakTime,PeakWidth,dataTree,Decoder,Parts);
+
+        if(findPeak && !wholeRun && WritePeakFile(peakName,PartialKeys,R))
+            MSG_INFO("[Analysis] Muon peak saved into " + peakName);
+
+        GIFWindowArray Windows;
+        SetTimeWindows(PeakTime,PeakWidth,Windows);
+
+        //****************** HISTOGRAMS & CANVAS *************************
+
+        //Histograms filled during the loop over the entries. Only their
+        //binning is set before the loop. The memory of a partition is
+        //allocated when it gets its first hit. When the loop is resumed,
+        //they already contain the entries before the checkpoint.
+        GIFLoopHistos& LoopH = R.LoopH;
+        if(!resumed) InitLoopHistos(LoopH,Parts,Mode);
+
         //****************** MACRO ***************************************
 
-        //Tabel to count the hits in every chamber partitions - used to
-        //compute the noise rate
-        GIFintArray Multiplicity = {{{0}}};
+        Uint nThreads = options.nThreads;
+        bool firstBlock = true;
 
-        Uint nEntries = dataTree->GetEntries();
+        //With checkpoints, the entries are looped over by blocks of
+        //CHECKPOINTENTRIES entries. At the end of a block, the loop
+        //histograms are saved if the last checkpoint is old enough.
+        Uint blockSize = (options.CheckpointPeriod > 0) ? CHECKPOINTENTRIES : lastEntry - resumeEntry;
+        time_t lastCheckpoint = time(NULL);
+        bool hasCheckpoint = resumed;
 
         MSG_INFO("[Analysis] Starting loop over entries...");
-        for(Uint i = 0; i < nEntries; i++){
-
-            //********** LOOP THROUGH HIT LIST ***************************
-
-            dataTree->GetEntry(i);
-
-            //Vectors to store the hits and reconstruct clusters:
-            //for muons
-            GIFHitList PeakHitList;
-            //and for noise/gammas
-            GIFHitList NoiseHitList;
-            //Add an extra vector to count number of fake events
-            //in the peak region by counting the number of events
-            //in a window as wide but uncorrelated
-            GIFHitList FakeHitList;
-
-            //Get quality flag in case of new format file
-            //and discard events with corrupted data.
-            if(!IsCorruptedEvent(data.QFlag)){
-
-                //Loop over the TDC hits
-                for(int h = 0; h < data.TDCCh->size(); h++){
-                    Uint tdcchannel = data.TDCCh->at(h);
-                    Uint rpcchannel = RPCChMap->GetLink(tdcchannel);
-                    float timestamp = data.TDCTS->at(h);
-
-                    //Get rid of the hits in channels not considered in the mapping
-                    if(rpcchannel != NOCHANNELLINK){
-                        RPCHit hit(rpcchannel, timestamp, GIFInfra);
-                        Uint T = hit.GetTrolley();
-                        Uint S = hit.GetStation()-1;
-                        Uint P = hit.GetPartition()-1;
-
-                        //Fill the time and hit profiles
-                        TimeProfile_H.rpc[T][S][P]->Fill(hit.GetTime());
-                        HitProfile_H.rpc[T][S][P]->Fill(hit.GetStrip());
-                        TimeVSChanProfile_H.rpc[T][S][P]->Fill(hit.GetStrip(),hit.GetTime());
-
-                        //Reject the 100 first ns due to inhomogeneity of data
-                        if(hit.GetTime() >= TIMEREJECT){
-                            Multiplicity.rpc[T][S][P]++;
-
-                            if(IsEfficiencyRun(RunType)){
-                                //First define the accepted peak time range for efficiency calculation
-                                float lowlimit_eff = PeakTime.rpc[T][S][P] - PeakWidth.rpc[T][S][P];
-                                float highlimit_eff = PeakTime.rpc[T][S][P] + PeakWidth.rpc[T][S][P];
-
-                                bool peakrange = (hit.GetTime() >= lowlimit_eff && hit.GetTime() < highlimit_eff);
-
-                                //Fill the hits inside of the defined peak and noise range
-                                if(peakrange){
-                                    BeamProfile_H.rpc[T][S][P]->Fill(hit.GetStrip());
-                                    PeakHitList.rpc[T][S][P].push_back(hit);
-                                } else {
-                                    StripNoiseProfile_H.rpc[T][S][P]->Fill(hit.GetStrip());
-                                    NoiseHitList.rpc[T][S][P].push_back(hit);
-                                }
-
-                                //Then define the accepted time range for fake efficiency calculation
-                                //that should be probed in a window as wide as the peak window but
-                                //uncorrelated with the trigger to measure the coincidence of noise
-                                //with the muon hits. The window stops at the end of the total time
-                                //window.
-                                float highlimit_fake = BMTDCWINDOW;
-                                float lowlimit_fake = highlimit_fake - (highlimit_eff-lowlimit_eff);
-
-                                bool fakerange = (hit.GetTime() >= lowlimit_fake && hit.GetTime() < highlimit_fake);
-
-                                //Fill the hits inside of the fake window
-                                if(fakerange){
-                                    FakeHitList.rpc[T][S][P].push_back(hit);
-                                }
-                            } else {
-                                //Fill the hits inside of the defined noise range
-                                StripNoiseProfile_H.rpc[T][S][P]->Fill(hit.GetStrip());
-                                NoiseHitList.rpc[T][S][P].push_back(hit);
-                            }
-                        }
-                    }
-                }
 
-                //********** MULTIPLICITY AND CLUSTERS ***********************
-
-                for(Uint tr = 0; tr < GIFInfra->GetNTrolleys(); tr++){
-                    Uint T = GIFInfra->GetTrolleyID(tr);
-
-                    for(Uint sl = 0; sl < GIFInfra->GetNSlots(tr); sl++){
-                        Uint S = GIFInfra->GetSlotID(tr,sl) - 1;
-                        Uint  nStripsPart   = GIFInfra->GetNStrips(tr,sl);
-                        string rpcID = GIFInfra->GetName(tr,sl);
-
-                        for (Uint p = 0; p < GIFInfra->GetNPartitions(tr,sl); p++){
-                            //In case the value of the multiplicity is beyond the actual
-                            //range, create a new histo with a wider range to store the data.
-                            //Do this work for all 3 multiplicity histograms. To make sure to
-                            //avoid repeating this operation too often, the range is chosen to
-                            //be the value that exceeds the range + 10.
-                            if(Multiplicity.rpc[T][S][p] > nBinsMult.rpc[T][S][p]){
-                                nBinsMult.rpc[T][S][p] = Multiplicity.rpc[T][S][p] + 10;
-
-                                //Hit multiplicity
-                                TList *listHM = new TList;
-                                listHM->Add(HitMultiplicity_H.rpc[T][S][p]);
-
-                                TH1* newHitMultiplicity_H = new TH1I("", "", nBinsMult.rpc[T][S][p], -0.5, nBinsMult.rpc[T][S][p]-0.5);
-                                newHitMultiplicity_H->Merge(listHM);
-
-                                delete HitMultiplicity_H.rpc[T][S][p];
-                                delete listHM;
-                                HitMultiplicity_H.rpc[T][S][p] = newHitMultiplicity_H;
-
-                                SetTitleName(rpcID,p,hisname,histitle,"Hit_Multiplicity","Hit Multiplicity");
-                                HitMultiplicity_H.rpc[T][S][p]->SetNameTitle(hisname,histitle);
-                                SetTH1(HitMultiplicity_H.rpc[T][S][p],"Multiplicity","Number of events");
-
-                                //Noise/gamma cluster multiplicity
-                                TList *listNCM = new TList;
-                                listNCM->Add(NoiseCMult_H.rpc[T][S][p]);
-
-                                TH1* newNoiseCMult_H = new TH1I("", "", nBinsMult.rpc[T][S][p], -0.5, nBinsMult.rpc[T][S][p]-0.5);
-                                newNoiseCMult_H->Merge(listNCM);
-
-                                delete NoiseCMult_H.rpc[T][S][p];
-                                delete listNCM;
-                                NoiseCMult_H.rpc[T][S][p] = newNoiseCMult_H;
-
-                                SetTitleName(rpcID,p,hisname,histitle,"NoiseCMult_H","Noise/gamma cluster multiplicity");
-                                NoiseCMult_H.rpc[T][S][p]->SetNameTitle(hisname,histitle);
-                                SetTH1(NoiseCMult_H.rpc[T][S][p],"Cluster multiplicity","Number of events");
-
-                                //Muon cluster multiplicity if effiency run
-                                if(IsEfficiencyRun(RunType)){
-                                    TList *listMCM = new TList;
-                                    listMCM->Add(MuonCMult_H.rpc[T][S][p]);
-
-                                    TH1* newPeakCMult_H = new TH1I("", "", nBinsMult.rpc[T][S][p], -0.5, nBinsMult.rpc[T][S][p]-0.5);
-                                    newPeakCMult_H->Merge(listMCM);
-                                    delete PeakCMult_H.rpc[T][S][p];
-                                    delete listMCM;
-                                    PeakCMult_H.rpc[T][S][p] = newPeakCMult_H;
-
-                                    SetTitleName(rpcID,p,hisname,histitle,"PeakCMult_H","Peak cluster multiplicity");
-                                    PeakCMult_H.rpc[T][S][p]->SetNameTitle(hisname,histitle);
-                                    SetTH1(PeakCMult_H.rpc[T][S][p],"Cluster multiplicity","Number of events");
-                                }
-                            }
-
-                            //Clusterize noise/gamma data
-                            sort(NoiseHitList.rpc[T][S][p].begin(),NoiseHitList.rpc[T][S][p].end(),SortHitbyTime);
-                            Clusterization(NoiseHitList.rpc[T][S][p],NoiseCSize_H.rpc[T][S][p],NoiseCMult_H.rpc[T][S][p]);
-
-                            //Clusterize muon data and fill efficiency histograms based on
-                            //the content of peak and fake hit vectors if efficiency run
-                            if(IsEfficiencyRun(RunType)){
-                                //Peak data
-                                sort(PeakHitList.rpc[T][S][p].begin(),PeakHitList.rpc[T][S][p].end(),SortHitbyTime);
-                                Clusterization(PeakHitList.rpc[T][S][p],PeakCSize_H.rpc[T][S][p],PeakCMult_H.rpc[T][S][p]);
-
-                                if(PeakHitList.rpc[T][S][p].size() > 0)
-                                    EfficiencyPeak_H.rpc[T][S][p]->Fill(DETECTED);
-                                else
-                                    EfficiencyPeak_H.rpc[T][S][p]->Fill(MISSED);
-
-                                //Fake data
-                                if(FakeHitList.rpc[T][S][p].size() > 0)
-                                    EfficiencyFake_H.rpc[T][S][p]->Fill(DETECTED);
-                                else
-                                    EfficiencyFake_H.rpc[T][S][p]->Fill(MISSED);
-                            }
-
-                            //Save and reinitialise the hit multiplicity
-                            HitMultiplicity_H.rpc[T][S][p]->Fill(Multiplicity.rpc[T][S][p]);
-                            Multiplicity.rpc[T][S][p] = 0;
-                        }
-                    }
-                }
+        for(Uint blockFirst = resumeEntry; blockFirst < lastEntry; ){
+            Uint blockLast = (lastEntry - blockFirst > blockSize) ? blockFirst + blockSize : lastEntry;
+            Uint nEntries = blockLast - blockFirst;
+
+            //There is no point in having more workers than entries
+            nThreads = options.nThreads;
+            if(nThreads > nEntries) nThreads = nEntries;
+
+            //Entry ranges of the workers. When the entries are read from the
+            //DAQ files, each file gets at least one reader of its own
+            bool readFiles = !useBuffer && !useCache && !options.Pipeline;
+            vector<EntryRange> Ranges;
+
+            if(readFiles)
+                SplitEntries(blockFirst,blockLast,nThreads,FileOffset,Ranges);
+            else {
+                vector<Uint> RunOffset(1,0);
+                RunOffset.push_back(R.nFileEntries);
+                SplitEntries(blockFirst,blockLast,nThreads,RunOffset,Ranges);
             }
-        }
 
-        //************** OUTPUT FILES ***********************************
-
-        //create a ROOT output file to save the histograms
-        string fNameROOT = baseName + "_Offline.root";
-        TFile outputfile(fNameROOT.c_str(), "recreate");
-
-        //********************************* Rate
-        //output csv file to save the list of parameters saved into the
-        //Offline-Rate.csv file - it represents the header of that file
-        string headNameRate = baseName.substr(0,baseName.find_last_of("/")) + "/Offline-Rate-Header.csv";
-        ofstream headRateCSV(headNameRate.c_str(),ios::out);
-        headRateCSV << "HVstep\t";
-
-        //output Rate csv file
-        string csvNameRate = baseName.substr(0,baseName.find_last_of("/")) + "/Offline-Rate.csv";
-        ofstream outputRateCSV(csvNameRate.c_str(),ios::app);
-        //Print the HV step as first column
-        outputRateCSV << HVstep << '\t';
-
-        //********************************* Corrupted data
-        //output csv file to save the percentage of corrupted data
-        //Offline-Corrupted-Header.csv
-        string headNameCorr = baseName.substr(0,baseName.find_last_of("/")) + "/Offline-Corrupted-Header.csv";
-        ofstream headCorrCSV(headNameCorr.c_str(),ios::out);
-        headCorrCSV << "HVstep\t";
-
-        //Offline-Corrupted.csv
-        string csvNameCorr = baseName.substr(0,baseName.find_last_of("/")) + "/Offline-Corrupted.csv";
-        ofstream outputCorrCSV(csvNameCorr.c_str(),ios::app);
-        //Print the HV step as first column
-        outputCorrCSV << HVstep << '\t';
-
-        //********************************* Efficiency, muon cluster
-        //output csv file to save the list of parameters saved into the
-        //Offline-L0-EffCl.csv file - it represents the header of that file
-        string headNameEff = baseName.substr(0,baseName.find_last_of("/")) + "/Offline-L0-EffCl-Header.csv";
-        ofstream headEffCSV(headNameEff.c_str(),ios::out);
-        headEffCSV << "HVstep\t";
-
-        //output csv file
-        string csvNameEff = baseName.substr(0,baseName.find_last_of("/")) + "/Offline-L0-EffCl.csv";
-        ofstream outputEffCSV(csvNameEff.c_str(),ios::app);
-        //Print the HV step as first column
-        outputEffCSV << HVstep << '\t';
-
-        //************** DATA ANALYSIS **********************************
-
-        //Loop over trolleys
-        for (Uint tr = 0; tr < GIFInfra->GetNTrolleys(); tr++){
-            Uint T = GIFInfra->GetTrolleyID(tr);
-
-            for (Uint sl = 0; sl < GIFInfra->GetNSlots(tr); sl++){
-                Uint S = GIFInfra->GetSlotID(tr,sl) - 1;
-
-                //Get the total chamber rate
-                //we need to now the total chamber surface (sum active areas)
-                Uint  nStripsPart   = GIFInfra->GetNStrips(tr,sl);
-                float RPCarea       = 0.;
-                float MeanNoiseRate = 0.;
-                float ClusterRate   = 0.;
-                float ClusterSDev   = 0.;
-
-                for (Uint p = 0; p < GIFInfra->GetNPartitions(tr,sl); p++){
-                    string partID = "ABCD";
-                    string partName = GIFInfra->GetName(tr,sl) + "-" + partID[p];
-
-                    //**************** CORRUPTED DATA ESTIMATION **********************************
-
-                    //In case of old format files (no quality flag), it is need to estimate
-                    //the amount of corrupted data via a fit as the corrupted data will
-                    //always fill events with a fake "0 multiplicity". Indeed, at first,
-                    //as this problem was believed to be small and negligible, no good
-                    //was put in trying to reject it directly using a quality flag. 2017
-                    //data showed us otherwise.
-                    int nEmptyEvent = 0;
-                    int nPhysics = 0;
-
-                    //Write the corrupted header file. This file will still be writen
-                    //even after the new file format has been used.
-                    headCorrCSV << "Corr-" << partName << "\t";
-
-                    if(!isNewFormat){
-                        //First of all, we will fit the multiplicity using first a gaussian
-                        //that is used to get parameter initialisation for a skew fit (it
-                        //works better to first fit with a gaussian).
-                        //BUT! the fit will hardly work in the case the mean of the distribution
-                        //is low and close to 0. To check that the fit worked, we will compare
-                        //the value given by the fit for multiplicity 1 (x=1) and ask for a
-                        //variation of less than 1% with respect to the data.
-
-                        //Start by getting the x range on wich we should perform the fit
-                        //We will re-use the same definition than for the multiplicity
-                        //histogram range
-                        double Xmax = (double)nBinsMult.rpc[T][S][p];
-
-                        //Then fit : Gauss then Skew (gauss divided by sigmoid to introduce
-                        //an asymmetry)
-                        TF1* GaussFit = new TF1("gaussfit","[0]*exp(-0.5*((x-[1])/[2])**2)",0,Xmax);
-                        GaussFit->SetParameter(0,100);
-                        GaussFit->SetParameter(1,10);
-                        GaussFit->SetParameter(2,1);
-                        HitMultiplicity_H.rpc[T][S][p]->Fit(GaussFit,"LIQR","",0.5,Xmax);
-
-                        TF1* SkewFit = new TF1("skewfit","[0]*exp(-0.5*((x-[1])/[2])**2) / (1 + exp(-[3]*(x-[4])))",0,Xmax);
-                        SkewFit->SetParameter(0,GaussFit->GetParameter(0));
-                        SkewFit->SetParameter(1,GaussFit->GetParameter(1));
-                        SkewFit->SetParameter(2,GaussFit->GetParameter(2));
-                        SkewFit->SetParameter(3,1);
-                        SkewFit->SetParameter(4,1);
-                        HitMultiplicity_H.rpc[T][S][p]->Fit(SkewFit,"LIQR","",0.5,Xmax);
-
-                        //Check that the fit worked:
-                        //  - make sure fit gives a value close enough to multiplicity = 1 bin
-                        //(variation of less than 1% with respect to the data)
-                        //  - make sure there is enough statistics (most of the data is not
-                        //contained in multiplicity 0 bin)
-                        //Then, if the fit is good but the value of the fit for multiplicity
-                        //0 is higher than the content of the data bin, keep the number of empty
-                        //events to 0 to make sure it does not turn negative.
-
-                        double fitValue = SkewFit->Eval(1,0,0,0);
-                        double dataValue = (double)HitMultiplicity_H.rpc[T][S][p]->GetBinContent(2);
-                        double difference = TMath::Abs(dataValue - fitValue);
-                        double fitTOdataVSentries_ratio = difference / (double)nEntries;
-                        bool isFitGOOD = fitTOdataVSentries_ratio < 0.01;
-
-                        double nSinglehit = (double)HitMultiplicity_H.rpc[T][S][p]->GetBinContent(1);
-                        double lowMultRatio = nSinglehit / (double)nEntries;
-                        bool isMultLOW = lowMultRatio > 0.4;
-
-                        if(isFitGOOD && !isMultLOW){
-                            nEmptyEvent = HitMultiplicity_H.rpc[T][S][p]->GetBinContent(1);
-                            nPhysics = (int)SkewFit->Eval(0,0,0,0);
-                            if(nPhysics < nEmptyEvent)
-                                nEmptyEvent = nEmptyEvent-nPhysics;
-                        }
-                    }
-
-                    //Print the percentage of corrupted data and the corresponding header
-                    double corrupt_ratio = 100.*(double)nEmptyEvent / (double)nEntries;
-                    outputCorrCSV << corrupt_ratio << '\t';
-
-                    //**************** RATE CALCULATION / NOISE HISTO RESCALING *******************
-
-                    //Write the rate header file
-                    headRateCSV <<   "Rate-" << partName << "\t"
-                                <<    "ClS-" << partName << "\t"
-                                <<    "ClS-" << partName << "_Err\t"
-                                <<    "ClM-" << partName << "\t"
-                                <<    "ClM-" << partName << "_Err\t"
-                                << "ClRate-" << partName << "\t"
-                                << "ClRate-" << partName << "_Err\t";
-
-                    //Get the mean noise on the strips and chips using the noise hit
-                    //profile. Normalise the number of hits in each bin by the integrated
-                    //time and the strip sruface (counts/s/cm2).
-                    float rate_norm = 0.;
-
-                    //Now we can proceed with getting the number of noise/gamma hits
-                    //and convert it into a noise/gamma rate per unit area.
-                    //Get the number of noise hits
-                    int nNoise = StripNoiseProfile_H.rpc[T][S][p]->GetEntries();
-
-                    //Get the strip geometry
-                    float stripArea = GIFInfra->GetStripGeo(tr,sl,p);
-
-                    if(IsEfficiencyRun(RunType)){
-                        float noiseWindow = BMTDCWINDOW - TIMEREJECT - 2*PeakWidth.rpc[T][S][p];
-                        rate_norm = (nEntries-nEmptyEvent)*noiseWindow*1e-9*stripArea;
-                    } else
-                        rate_norm = (nEntries-nEmptyEvent)*RDMNOISEWDW*1e-9*stripArea;
-
-                    //Get the average number of hits per strip to normalise the activity
-                    //histogram (this number is the same for both Strip and Chip histos).
-                    float averageNhit = (nNoise>0) ? (float)(nNoise/nStripsPart) : 1.;
-
-                    for(Uint st = 1; st <= nStripsPart; st++){
-                        //Get profit of the loop over strips to subtract the
-                        //average background from the beam profile. This average
-                        //calculated strip by strip is obtained using a proportionnality
-                        //rule on the number of hits measured during the noise
-                        //window and the time width of the peak
-                        if(IsEfficiencyRun(RunType)){
-                            int nNoiseHits = StripNoiseProfile_H.rpc[T][S][p]->GetBinContent(st);
-                            float noiseWindow = BMTDCWINDOW - TIMEREJECT - 2*PeakWidth.rpc[T][S][p];
-                            float peakWindow = 2*PeakWidth.rpc[T][S][p];
-                            float nNoisePeak = nNoiseHits*peakWindow/noiseWindow;
-
-                            int nPeakHits = BeamProfile_H.rpc[T][S][p]->GetBinContent(st);
-
-                            float correctedContent = (nPeakHits<nNoisePeak) ? 0. : (float)nPeakHits-nNoisePeak;
-                            BeamProfile_H.rpc[T][S][p]->SetBinContent(st,correctedContent);
+            if(options.Pipeline && !useBuffer && !useCache){
+                if(firstBlock)
+                    MSG_INFO("[Analysis] Entries read ahead for " + intToString(nThreads) + " analysis threads");
+
+                //The entries are read by this thread only. The analysis
+                //threads get chunks of entries in turn and fill their own
+                //copy of the loop histos.
+                vector<GIFLoopHistos> WorkerH(nThreads);
+
+                for(Uint w = 0; w < nThreads; w++)
+                    CloneLoopHistos(LoopH,WorkerH[w]);
+
+                ProcessPipeline(dataTree,blockFirst,blockLast,WorkerH,Windows,Mode,isNewFormat,
+                                Decoder,Parts,options.PrefetchDepth);
+
+                for(Uint w = 0; w < nThreads; w++)
+                    MergeLoopHistos(LoopH,WorkerH[w]);
+            } else if(Ranges.size() <= 1){
+                if(useCache)
+                    ProcessCache(*Cache,blockFirst,blockLast,LoopH,Windows,Mode,Decoder,Parts);
+                else if(useBuffer)
+                    ProcessBuffer(DataBuffer,blockFirst,blockLast,LoopH,Windows,Mode,Decoder,Parts);
+                else
+                    ProcessEntries(dataTree,blockFirst,blockLast,LoopH,Windows,Mode,isNewFormat,Decoder,Parts);
+            } else {
+                nThreads = Ranges.size();
+
+                if(firstBlock)
+                    MSG_INFO("[Analysis] Loop split over " + intToString(nThreads) + " threads");
+
+                //Each worker gets a contiguous range of entries of a single
+                //DAQ file, its own copy of this file (a TTree can't be read
+                //by several threads at once) and of the loop histos.
+                //In single pass mode, the workers share the data buffer
+                //instead of opening the file again, and so is the hit cache
+                //when there is one.
+                ROOT::EnableThreadSafety();
+
+                vector<GIFLoopHistos> WorkerH(nThreads);
+                vector<thread> Workers;
+
+                for(Uint w = 0; w < nThreads; w++)
+                    CloneLoopHistos(LoopH,WorkerH[w]);
+
+                for(Uint w = 0; w < nThreads; w++){
+                    Uint first = Ranges[w].First;
+                    Uint last  = Ranges[w].Last;
+                    Uint file  = Ranges[w].File;
+
+                    Workers.push_back(thread([&,w,first,last,file](){
+                        if(useCache){
+                            ProcessCache(*Cache,first,last,WorkerH[w],Windows,Mode,
+                                         Decoder,Parts);
+                            return;
                         }
 
-                        //Get full RPCCh info usinf format TSCCC
-                        Uint RPCCh = T*1e4 + (S+1)*1e3 + st + p*nStripsPart;
-
-                        //Fill noise rates and activities, and apply mask
-                        float stripRate = StripNoiseProfile_H.rpc[T][S][p]->GetBinContent(st)/rate_norm;
-                        float stripAct = StripNoiseProfile_H.rpc[T][S][p]->GetBinContent(st)/averageNhit;
-
-                        if(RPCChMap->GetMask(RPCCh) == ACTIVE){
-                            StripNoiseProfile_H.rpc[T][S][p]->SetBinContent(st,stripRate);
-                            StripActivity_H.rpc[T][S][p]->SetBinContent(st,stripAct);
-                        } else if (RPCChMap->GetMask(RPCCh) == MASKED){
-                            StripNoiseProfile_H.rpc[T][S][p]->SetBinContent(st,0.);
-                            StripActivity_H.rpc[T][S][p]->SetBinContent(st,0.);
-                            MaskNoiseProfile_H.rpc[T][S][p]->SetBinContent(st,stripRate);
-                            MaskActivity_H.rpc[T][S][p]->SetBinContent(st,stripAct);
+                        if(useBuffer){
+                            ProcessBuffer(DataBuffer,first,last,WorkerH[w],Windows,Mode,
+                                          Decoder,Parts);
+                            return;
                         }
-                    }
-
-                    for(Uint ch = 0; ch < (nStripsPart/NSTRIPSCHIP); ch++){
-                        //The chip rate and activity only iare incremented by a rate
-                        //that is normalised to the number of active strip per chip
-                        ChipMeanNoiseProf_H.rpc[T][S][p]->SetBinContent(ch+1,GetChipBin(StripNoiseProfile_H.rpc[T][S][p],ch));
-                        ChipActivity_H.rpc[T][S][p]->SetBinContent(ch+1,GetChipBin(StripActivity_H.rpc[T][S][p],ch));
-                    }
-
-                    //Write in the output file the mean noise rate per
-                    //partition
-                    float MeanPartRate = GetTH1Mean(StripNoiseProfile_H.rpc[T][S][p]);
-                    float cSizePart = NoiseCSize_H.rpc[T][S][p]->GetMean();
-                    float cSizePartErr = (NoiseCSize_H.rpc[T][S][p]->GetEntries() == 0)
-                            ? 0.
-                            : 2*NoiseCSize_H.rpc[T][S][p]->GetStdDev()/sqrt(NoiseCSize_H.rpc[T][S][p]->GetEntries());
-                    float cMultPart = NoiseCMult_H.rpc[T][S][p]->GetMean();
-                    float cMultPartErr = (NoiseCMult_H.rpc[T][S][p]->GetEntries() == 0)
-                            ? 0.
-                            : 2*NoiseCMult_H.rpc[T][S][p]->GetStdDev()/sqrt(NoiseCMult_H.rpc[T][S][p]->GetEntries());
-                    float ClustPartRate = (cSizePart==0)
-                            ? 0.
-                            : MeanPartRate/cSizePart;
-                    float ClustPartRateErr = (cSizePart==0)
-                            ? 0.
-                            : ClustPartRate * cSizePartErr/cSizePart;
-
-                    outputRateCSV << MeanPartRate << '\t'
-                                  << cSizePart << '\t' << cSizePartErr << '\t'
-                                  << cMultPart << '\t' << cMultPartErr << '\t'
-                                  << ClustPartRate << '\t' << ClustPartRateErr << '\t';
-
-                    //Get the partition homogeneity defined as exp(RMS(noise)/MEAN(noise))
-                    //The closer the homogeneity is to 1 the more homogeneus, the closer
-                    //the homogeneity is to 0 the less homogeneous.
-                    //This gives idea about noisy strips and dead strips.
-                    float MeanPartSDev = GetTH1StdDev(StripNoiseProfile_H.rpc[T][S][p]);
-                    float strip_homog = (MeanPartRate==0)
-                            ? 0.
-                            : exp(-MeanPartSDev/MeanPartRate);
-                    StripHomogeneity_H.rpc[T][S][p]->Fill("exp -#left(#frac{#sigma_{Strip Rate}}{#mu_{Strip Rate}}#right)",strip_homog);
-                    StripHomogeneity_H.rpc[T][S][p]->GetYaxis()->SetRangeUser(0.,1.);
-
-                    //Same thing for the chip level - need to get the RMS at the chip level, the mean stays the same
-                    float ChipStDevMean = GetTH1StdDev(ChipMeanNoiseProf_H.rpc[T][S][p]);
-
-                    float chip_homog = (MeanPartRate==0)
-                            ? 0.
-                            : exp(-ChipStDevMean/MeanPartRate);
-                    ChipHomogeneity_H.rpc[T][S][p]->Fill("exp -#left(#frac{#sigma_{Chip Rate}}{#mu_{Chip Rate}}#right)",chip_homog);
-                    ChipHomogeneity_H.rpc[T][S][p]->GetYaxis()->SetRangeUser(0.,1.);
-
-                    //Push the partition results into the chamber level
-                    RPCarea       += stripArea * nStripsPart;
-                    MeanNoiseRate += MeanPartRate * stripArea * nStripsPart;
-                    ClusterRate   += ClustPartRate * stripArea * nStripsPart;
-                    ClusterSDev   += (cSizePart==0)
-                            ? 0.
-                            : ClusterRate*cSizePartErr/cSizePart;
-
-                    //******************************* Print the peak gaussian fit
-                    if(IsEfficiencyRun(RunType)){
-                        TF1 *peakfit = new TF1("slicefit","gaus(0)",TIMEREJECT,BMTDCWINDOW);
-
-                        //Prefit to get the curve on the histogram
-                        peakfit->SetRange(PeakTime.rpc[T][S][p]-PeakWidth.rpc[T][S][p],PeakTime.rpc[T][S][p]+PeakWidth.rpc[T][S][p]);
-                        TimeProfile_H.rpc[T][S][p]->Fit(peakfit,"QR");
-
-                        //Reset with parameters extracted from earlier call of SetBeamWindow(...)
-                        //Amplitude
-                        peakfit->SetParameter(0,PeakHeight.rpc[T][S][p]);
-                        //Mean value
-                        peakfit->SetParameter(1,PeakTime.rpc[T][S][p]);
-                        //RMS
-                        peakfit->SetParameter(2,PeakWidth.rpc[T][S][p]);
-                    }
-
-                    //Draw and write the histograms into the output ROOT file
-                    //******************************* General histograms
-
-                    TimeProfile_H.rpc[T][S][p]->Write();
-                    HitProfile_H.rpc[T][S][p]->Write();
-                    HitMultiplicity_H.rpc[T][S][p]->Write();
-                    TimeVSChanProfile_H.rpc[T][S][p]->Write();
-
-                    //******************************* Strip granularity histograms
-
-                    StripNoiseProfile_H.rpc[T][S][p]->Write();
-                    StripActivity_H.rpc[T][S][p]->Write();
-                    StripHomogeneity_H.rpc[T][S][p]->Write();
-                    MaskNoiseProfile_H.rpc[T][S][p]->Write();
-                    MaskActivity_H.rpc[T][S][p]->Write();
-                    NoiseCSize_H.rpc[T][S][p]->Write();
-                    NoiseCMult_H.rpc[T][S][p]->Write();
-
-                    //******************************* Chip granularity histograms
-
-                    ChipMeanNoiseProf_H.rpc[T][S][p]->Write();
-                    ChipActivity_H.rpc[T][S][p]->Write();
-                    ChipHomogeneity_H.rpc[T][S][p]->Write();
-
-                    //**************** EFFICIENCY/MUON CLUSTER SIZE/MULTIPLICITY ****************
-
-                    if(IsEfficiencyRun(RunType)){
-                        //Write the efficiency/cluster header file
-                        headEffCSV << "Eff-" << partName << '\t'
-                                   << "Eff-" << partName << "_Err\t"
-                                   << "ClS-" << partName << '\t'
-                                   << "ClS-" << partName << "_Err\t"
-                                   << "ClM-" << partName << '\t'
-                                   << "ClM-" << partName << "_Err\t";
-
-                        //For each cases, evaluate the proportion of noise that
-                        //contributes to the efficiency thanks to the peak and
-                        //fake efficiency evaluation. Then, the peak efficiency
-                        //is the probability to have at least 1 muon hit OR 1
-                        //fake hit P(mu OR fake). The probability to have fake
-                        //hits contributing to the efficiency is simply P(fake)
-                        //measured by the fake efficiency histogram. Finally,
-                        //using probabilities, we can say that:
-                        //P(mu OR fake) = P(peak) = P(mu)+P(fake)-P(mu)*P(fake)
-                        //using that the probability of the union is the sum of
-                        //the individual probabilities minus the probability of
-                        //the intersection. In the end, we have:
-                        //P(mu) = (P(peak)-P(fake))/(1-P(fake))
-                        //Each P as a binomial error:
-                        //dP = SQRT(P*(1-P)/N)
-                        float P_peak = EfficiencyPeak_H.rpc[T][S][p]->GetMean();
-                        float P_fake = EfficiencyFake_H.rpc[T][S][p]->GetMean();
-                        float P_muon = (P_peak-P_fake)/(1-P_fake);
-                        float P_both = P_muon*P_fake;
-                        float P_peak_err = sqrt(P_peak*(1.-P_peak)/nEntries);
-                        float P_fake_err = sqrt(P_fake*(1.-P_fake)/nEntries);
-                        float P_muon_err = sqrt(P_muon*(1.-P_muon)/nEntries);
-                        float P_both_err = sqrt(P_both*(1.-P_both)/nEntries);
-
-                        //In the same way, probing the probabilities to have
-                        //events with muon alone, fake alone or both, it is
-                        //possible to get the real muon cluster size.
-                        //P(peak) = P(mu)+P(fake)-P(mu&&fake)
-                        //1 = F(mu) + F(fake) + F(mu&&fake) where F are the
-                        //fractions of each cases, 1 being all the cases. The
-                        //fractions F, expressed with the corresponding P are
-                        //F = P/P(peak) = P/P(mu||fake).
-                        //Which give the following error for the fractions F:
-                        //dF = F*(dP/P+dP(peak)/P(peak))
-                        //The cluster size measured is then:
-                        //Cpeak = Cmu*F(mu)+Cfake*F(fake)+(Cmu+Cfake)*F(mu&&fake)/2
-                        //assuming the cluster size in case where both muon and
-                        //fake are seen is the average of both. Leading to:
-                        //Cmu = (Cpeak-Cfake*(F(fake)+F(mu&&fake)/2))/(F(mu)+F(fake)/2)
-                        //The errors on Cpeak and Cfake corresponds to their
-                        //respective histograms statistical error:
-                        //dC = 2*STDV(C)/SQRT(N)
-                        //All this will help getting the error propagation to Cmu
-
-                        float F_both = P_both/P_peak;
-                        float F_muon = (P_muon-P_both)/P_peak;
-                        float F_fake = (P_fake-P_both)/P_peak;
-                        float F_both_err = F_both*(P_both_err/P_both+P_peak_err/P_peak);
-                        float F_muon_err = (P_muon_err+F_both_err+F_muon*P_peak_err)/P_peak;
-                        float F_fake_err = (P_fake_err+F_both_err+F_fake*P_peak_err)/P_peak;
-
-                        float CS_peak = PeakCSize_H.rpc[T][S][p]->GetMean();
-                        float CS_fake = NoiseCSize_H.rpc[T][S][p]->GetMean();
-                        float CS_peak_err = 2*PeakCSize_H.rpc[T][S][p]->GetStdDev()/sqrt(PeakCSize_H.rpc[T][S][p]->GetEntries());
-                        float CS_fake_err = 2*NoiseCSize_H.rpc[T][S][p]->GetStdDev()/sqrt(NoiseCSize_H.rpc[T][S][p]->GetEntries());
-
-                        float CS_muon = (CS_peak-CS_fake*(F_fake+F_both/2.))/(F_muon+F_both/2.);
-                        float CS_muon_err = (CS_peak_err
-                                             +(F_fake+F_both/2.)*CS_fake_err
-                                             +CS_muon*F_muon_err
-                                             +CS_fake*(F_fake_err+F_both_err/2.))
-                                            /(F_muon+F_both/2.);
-
-                        //Finally get the muon cluster multiplicity based on the
-                        //asumption that the average peak multiplicity is the sum
-                        //of the muon and fakes.
-                        //Mpeak = Mmu + Mfake so Mmu = Mpeak - Mfake
-                        //The fake multiplicity is simply the background one but
-                        //normalized to the peak time window.
-                        //The errors on Mpeak and Mfake corresponds to their
-                        //respective histograms statistical error:
-                        //dM = 2*STDV(M)/SQRT(N)
-                        //All this will help getting the error propagation to Mmu
-                        float noiseWindow = BMTDCWINDOW - TIMEREJECT - 2*PeakWidth.rpc[T][S][p];
-                        float peakWindow = 2*PeakWidth.rpc[T][S][p];
-
-                        float CM_peak = PeakCMult_H.rpc[T][S][p]->GetMean();
-                        float CM_fake = NoiseCMult_H.rpc[T][S][p]->GetMean() * peakWindow/noiseWindow;
-                        float CM_muon = CM_peak-CM_fake;
-
-                        float CM_peak_err = 2*PeakCMult_H.rpc[T][S][p]->GetStdDev()/sqrt(PeakCMult_H.rpc[T][S][p]->GetEntries());
-                        float CM_fake_err = 2*NoiseCMult_H.rpc[T][S][p]->GetStdDev()/sqrt(NoiseCMult_H.rpc[T][S][p]->GetEntries())
-                                            * peakWindow/noiseWindow;
-                        float CM_muon_err = CM_peak_err + CM_fake_err;
-
-                        //Write in the output CSV file
-                        outputEffCSV << P_muon << '\t' << P_muon_err << '\t'
-                                     << CS_muon << '\t' << CS_muon_err << '\t'
-                                     << CM_peak << '\t' << CM_peak_err << '\t';
-
-                        //Fill L0 efficiency histogram
-                        Efficiency0_H.rpc[T][S][p]->Fill("muon efficiency",P_muon);
-                        Efficiency0_H.rpc[T][S][p]->Fill("muon efficiency error",P_muon_err);
-                        Efficiency0_H.rpc[T][S][p]->GetYaxis()->SetRangeUser(0.,1.);
-
-                        //Fill L0 muon cluster size histogram
-                        MuonCSize_H.rpc[T][S][p]->Fill("muon cluster size",CS_muon);
-                        MuonCSize_H.rpc[T][S][p]->Fill("muon cluster size error",CS_muon_err);
-
-                        //Fill L0 muon cluster multiplicity histogram
-                        MuonCMult_H.rpc[T][S][p]->Fill("muon cluster multiplicity",CM_muon);
-                        MuonCMult_H.rpc[T][S][p]->Fill("muon cluster multiplicity error",CM_muon_err);
-
-                        //******************************* muon histograms
-
-                        BeamProfile_H.rpc[T][S][p]->Write();
-                        EfficiencyFake_H.rpc[T][S][p]->Write();
-                        EfficiencyPeak_H.rpc[T][S][p]->Write();
-                        PeakCSize_H.rpc[T][S][p]->Write();
-                        PeakCMult_H.rpc[T][S][p]->Write();
-                        Efficiency0_H.rpc[T][S][p]->Write();
-                        MuonCSize_H.rpc[T][S][p]->Write();
-                        MuonCMult_H.rpc[T][S][p]->Write();
-                    }
-                }
 
-                //Finalise the calculation of the chamber rate
-                MeanNoiseRate /= RPCarea;
-                ClusterRate   /= RPCarea;
-                ClusterSDev   /= RPCarea;
+                        //The entries of the file are numbered from its own start
+                        Uint fileFirst = first - FileOffset[file];
+                        Uint fileLast  = last - FileOffset[file];
 
-                //Write the header file
-                headRateCSV << "Rate-" << GIFInfra->GetName(tr,sl) << "-TOT\t"
-                            << "ClRate-" << GIFInfra->GetName(tr,sl) << "-TOT\t"
-                            << "ClRate-" << GIFInfra->GetName(tr,sl) << "-TOT_Err\t";
+                        TFile workerFile(DAQFiles[file].c_str());
+                        TTree* workerTree = (TTree*)workerFile.Get("RAWData");
+                        SetTreeReading(workerTree,isNewFormat,fileFirst,fileLast,options.CacheSizeMB);
 
-                //Write the output file
-                outputRateCSV << MeanNoiseRate << '\t'
-                              << ClusterRate << '\t' << ClusterSDev << '\t';
+                        ProcessEntries(workerTree,fileFirst,fileLast,WorkerH[w],Windows,Mode,
+                                       isNewFormat,Decoder,Parts);
+                        workerFile.Close();
+                    }));
+                }
+
+                for(Uint w = 0; w < nThreads; w++)
+                    Workers[w].join();
+
+                //Merge the workers following the order of their entry ranges
+                //so that the result doesn't depend on the thread scheduling
+                for(Uint w = 0; w < nThreads; w++)
+                    MergeLoopHistos(LoopH,WorkerH[w]);
             }
-        }
-        //Close output files
-        headRateCSV << '\n';
-        headRateCSV.close();
 
-        outputRateCSV << '\n';
-        outputRateCSV.close();
+            blockFirst = blockLast;
+            firstBlock = false;
 
-        headCorrCSV << '\n';
-        headCorrCSV.close();
+            //Save the loop histograms of the entries [firstEntry,blockFirst[
+            if(options.CheckpointPeriod > 0 && blockFirst < lastEntry
+               && time(NULL) - lastCheckpoint >= (time_t)options.CheckpointPeriod){
+                R.Last = blockFirst;
 
-        outputCorrCSV << '\n';
-        outputCorrCSV.close();
+                if(WritePartial(checkpointName,PartialKeys,R)){
+                    MSG_INFO("[Analysis] Checkpoint after " + longTostring(blockFirst) + " entries");
+                    hasCheckpoint = true;
+                }
 
-        headEffCSV << '\n';
-        headEffCSV.close();
+                lastCheckpoint = time(NULL);
+            }
+        }
+
+        R.Last = lastEntry;
 
-        outputEffCSV << '\n';
-        outputEffCSV.close();
+        //The loop is complete : the checkpoint is not needed anymore
+        if(hasCheckpoint) remove(checkpointName.c_str());
 
-        outputfile.Close();
+        delete dataTree;
         dataFile.Close();
+        delete Cache;
+
+        return true;
     } else {
         MSG_INFO("[Offline] File " + daqName + " could not be opened");
         MSG_INFO("[Offline] Skipping offline analysis");
+
+        return false;
     }
 }
+
+// ****************************************************************************************************
+// *    void FinishStep(string baseName, AnalysisOptions& options, AnalysisSetup& setup,
+// *                    LoopResults& R, string rootName, AnalysisOutput& output)
+//
+//  Analysis of a HV step once its loop is over : books the histograms out of the loop histograms of
+//  R, analyses every partition, writes the histograms into the ROOT file rootName (usually
+//  baseName_Offline.root) and the CSV headers and rows into output. The loop results can come from
+//  a single loop over the DAQ file or from merged partial results.
+// ****************************************************************************************************
+
+void FinishStep(string baseName, AnalysisOptions& options, AnalysisSetup& setup,
+                LoopResults& R, string rootName, AnalysisOutput& output){
+    PartitionTable* Parts = setup.Parts;
+    Mapping* RPCChMap = setup.RPCChMap;
+    Uint nPartitions = Parts->GetNPartitions();
+
+    //Get the HVstep number from the base name
+    string HVstep = baseName.substr(baseName.find_last_of("_HV")+1);
+
+    RunMode Mode = R.Mode;
+    bool isNewFormat = R.isNewFormat;
+    Uint nEntries = R.Last - R.First;
+    GIFLoopHistos& LoopH = R.LoopH;
+    muonPeak& PeakTime = R.PeakTime;
+    muonPeak& PeakWidth = R.PeakWidth;
+
+    //Book the histograms out of the content of the loop histograms.
+    //The histograms are kept out of ROOT's directories and deleted
+    //at the end of the analysis. The muon histograms are only needed
+    //for efficiency runs.
+    GIFH1Array TimeProfile_H(nPartitions);
+    GIFH1Array HitProfile_H(nPartitions);
+    GIFH1Array HitMultiplicity_H(nPartitions);
+    GIFH2Array TimeVSChanProfile_H(nPartitions);
+
+    GIFH1Array StripNoiseProfile_H(nPartitions);
+    GIFH1Array StripActivity_H(nPartitions);
+    GIFH1Array StripHomogeneity_H(nPartitions);
+    GIFH1Array MaskNoiseProfile_H(nPartitions);
+    GIFH1Array MaskActivity_H(nPartitions);
+    GIFH1Array NoiseCSize_H(nPartitions);
+    GIFH1Array NoiseCMult_H(nPartitions);
+
+    GIFH1Array ChipMeanNoiseProf_H(nPartitions);
+    GIFH1Array ChipActivity_H(nPartitions);
+    GIFH1Array ChipHomogeneity_H(nPartitions);
+
+    GIFH1Array BeamProfile_H(nPartitions);
+    GIFH1Array EfficiencyFake_H(nPartitions);
+    GIFH1Array EfficiencyPeak_H(nPartitions);
+    GIFH1Array PeakCSize_H(nPartitions);
+    GIFH1Array PeakCMult_H(nPartitions);
+    GIFH1Array Efficiency0_H(nPartitions);
+    GIFH1Array MuonCSize_H(nPartitions);
+    GIFH1Array MuonCMult_H(nPartitions);
+
+    char hisname[50];  //ID name of the histogram
+    char histitle[50]; //Title of the histogram
+
+    //Set a table to get the ranges of different multiplicity
+    //histograms. The range is known once the loop is over and
+    //adapted to the largest multiplicity value. This variable
+    //will also be used to later know the fitting range of
+    //multiplicity histograms.
+    GIFnBinsMult nBinsMult(nPartitions,0);
+
+    for (Uint i = 0; i < nPartitions; i++){
+        //Get the chamber ID name and the partition
+        const PartitionInfo& part = Parts->GetInfo(i);
+        string rpcID = part.RPCName;
+        Uint p = part.Partition;
+
+        //Set bining
+        Uint nStrips = part.nStrips;
+        float low_s = nStrips*p + 0.5;
+        float high_s = nStrips*(p+1) + 0.5;
+
+        //The cluster multiplicities can't be larger than the hit
+        //multiplicity and the 3 histograms share its range
+        nBinsMult.rpc[i] = LoopH.HitMultiplicity.rpc[i].GetNBins();
+
+        //****************************************** General histograms
+
+        //Time profile
+        SetTitleName(rpcID,p,hisname,histitle,"Time_Profile","Time profile");
+        TimeProfile_H.rpc[i] = LoopH.TimeProfile.rpc[i].MakeTH1F(hisname, histitle);
+        SetTH1(TimeProfile_H.rpc[i],"Time (ns)","Number of hits");
+
+        //Hit profile
+        SetTitleName(rpcID,p,hisname,histitle,"Hit_Profile","Hit profile");
+        HitProfile_H.rpc[i] = LoopH.HitProfile.rpc[i].MakeTH1I(hisname, histitle);
+        SetTH1(HitProfile_H.rpc[i],"Strip","Number of events");
+
+        //Hit multiplicity
+        SetTitleName(rpcID,p,hisname,histitle,"Hit_Multiplicity","Hit multiplicity");
+        HitMultiplicity_H.rpc[i] = LoopH.HitMultiplicity.rpc[i].MakeHisto(hisname,histitle,nBinsMult.rpc[i]);
+        SetTH1(HitMultiplicity_H.rpc[i],"Multiplicity","Number of events");
+
+        //2D Time vs hit profile
+        SetTitleName(rpcID,p,hisname,histitle,"Time_vs_Strip_Profile","Time vs Strip 2D profile");
+        TimeVSChanProfile_H.rpc[i] = LoopH.TimeVSChanProfile.rpc[i].MakeTH2F(hisname, histitle);
+        TimeVSChanProfile_H.rpc[i]->SetOption("COLZ");
+        SetTH2(TimeVSChanProfile_H.rpc[i],"Strip","Time (ns)","Number of hits");
+
+        //****************************************** Strip granularuty level histograms
+
+        //Mean noise/gamma rate profile
+        SetTitleName(rpcID,p,hisname,histitle,"Strip_Mean_Noise","Strip mean noise rate");
+        StripNoiseProfile_H.rpc[i] = LoopH.StripNoiseProfile.rpc[i].MakeTH1F(hisname, histitle);
+        SetTH1(StripNoiseProfile_H.rpc[i],"Strip","Rate (Hz/cm^{2})");
+
+        //Strip activity
+        SetTitleName(rpcID,p,hisname,histitle,"Strip_Activity","Strip activity");
+        StripActivity_H.rpc[i] = new TH1F(hisname, histitle, nStrips, low_s, high_s);
+        SetTH1(StripActivity_H.rpc[i],"Strip","Activity (normalized strip profil)");
+
+        //Noise/gamma homogeneity
+        SetTitleName(rpcID,p,hisname,histitle,"Strip_Homogeneity","Strip homogeneity");
+        StripHomogeneity_H.rpc[i] = new TH1F(hisname, histitle, 1, 0, 1);
+        StripHomogeneity_H.rpc[i]->SetOption("TEXT");
+        SetTH1(StripHomogeneity_H.rpc[i],"","Homogeneity");
+
+        //Masked strip mean noise/gamma rate profile
+        SetTitleName(rpcID,p,hisname,histitle,"mask_Strip_Mean_Noise","Masked strip mean noise rate");
+        MaskNoiseProfile_H.rpc[i] = new TH1F(hisname, histitle, nStrips, low_s, high_s);
+        SetTH1(MaskNoiseProfile_H.rpc[i],"Strip","Rate (Hz/cm^{2})");
+
+        //Masked strip activity
+        SetTitleName(rpcID,p,hisname,histitle,"mask_Strip_Activity","Masked strip activity");
+        MaskActivity_H.rpc[i] = new TH1F(hisname, histitle, nStrips, low_s, high_s);
+        SetTH1(MaskActivity_H.rpc[i],"Strip","Activity (normalized strip profil)");
+
+        //Noise/gamma cluster size
+        SetTitleName(rpcID,p,hisname,histitle,"NoiseCSize_H","Noise/gamma cluster size");
+        NoiseCSize_H.rpc[i] = LoopH.NoiseCSize.rpc[i].MakeTH1I(hisname, histitle);
+        SetTH1(NoiseCSize_H.rpc[i],"Cluster size","Number of events");
+
+        //Noise/gamma cluster multiplicity
+        SetTitleName(rpcID,p,hisname,histitle,"NoiseCMult_H","Noise/gamma cluster multiplicity");
+        NoiseCMult_H.rpc[i] = LoopH.NoiseCMult.rpc[i].MakeHisto(hisname,histitle,nBinsMult.rpc[i]);
+        SetTH1(NoiseCMult_H.rpc[i],"Cluster multiplicity","Number of events");
+
+        //****************************************** Chip granularuty level histograms
+
+        //Mean noise rate profile
+        SetTitleName(rpcID,p,hisname,histitle,"Chip_Mean_Noise","Chip mean noise rate");
+        ChipMeanNoiseProf_H.rpc[i] = new TH1F(hisname, histitle, nStrips/8, low_s, high_s);
+        SetTH1(ChipMeanNoiseProf_H.rpc[i],"Chip","Rate (Hz/cm^{2})");
+
+        //Strip activity
+        SetTitleName(rpcID,p,hisname,histitle,"Chip_Activity","Chip activity");
+        ChipActivity_H.rpc[i] = new TH1F(hisname, histitle, nStrips/8, low_s, high_s);
+        SetTH1(ChipActivity_H.rpc[i],"Chip","Activity (normalized chip profil)");
+
+        //Noise homogeneity
+        SetTitleName(rpcID,p,hisname,histitle,"Chip_Homogeneity","Chip homogeneity");
+        ChipHomogeneity_H.rpc[i] = new TH1F(hisname, histitle, 1, 0, 1);
+        ChipHomogeneity_H.rpc[i]->SetOption("TEXT");
+        SetTH1(ChipHomogeneity_H.rpc[i],"","Homogeneity");
+
+        //****************************************** Muon histogram
+
+        if(Mode != EFFICIENCY) continue;
+
+        //Beam profile
+        SetTitleName(rpcID,p,hisname,histitle,"Beam_Profile","Beam profile");
+        BeamProfile_H.rpc[i] = LoopH.BeamProfile.rpc[i].MakeTH1I(hisname, histitle);
+        SetTH1(BeamProfile_H.rpc[i],"Strip","Number of hits");
+
+        //Efficiency due to noise/background
+        SetTitleName(rpcID,p,hisname,histitle,"Efficiency_Fake","Fake efficiency");
+        EfficiencyFake_H.rpc[i] = LoopH.EfficiencyFake.rpc[i].MakeTH1I(hisname, histitle);
+        SetTH1(EfficiencyFake_H.rpc[i],"Is efficient?","Number of events");
+
+        //Efficiency due to in time hits
+        SetTitleName(rpcID,p,hisname,histitle,"Efficiency_Peak","Peak efficiency");
+        EfficiencyPeak_H.rpc[i] = LoopH.EfficiencyPeak.rpc[i].MakeTH1I(hisname, histitle);
+        SetTH1(EfficiencyPeak_H.rpc[i],"Is efficient?","Number of events");
+
+        //Peak cluster Size
+        SetTitleName(rpcID,p,hisname,histitle,"PeakCSize_H","Peak cluster size");
+        PeakCSize_H.rpc[i] = LoopH.PeakCSize.rpc[i].MakeTH1I(hisname, histitle);
+        SetTH1(PeakCSize_H.rpc[i],"Cluster size","Number of events");
+
+        //Peak cluster multiplicity
+        SetTitleName(rpcID,p,hisname,histitle,"PeakCMult_H","Peak cluster multiplicity");
+        PeakCMult_H.rpc[i] = LoopH.PeakCMult.rpc[i].MakeHisto(hisname,histitle,nBinsMult.rpc[i]);
+        SetTH1(PeakCMult_H.rpc[i],"Cluster multiplicity","Number of events");
+
+        //Corrected muon efficiency
+        SetTitleName(rpcID,p,hisname,histitle,"L0_Efficiency","L0 efficiency");
+        Efficiency0_H.rpc[i] = new TH1F(hisname, histitle, 2, 0, 2);
+        Efficiency0_H.rpc[i]->SetOption("TEXT");
+        SetTH1(Efficiency0_H.rpc[i],"","");
+
+        //Corrected muon cluster size
+        SetTitleName(rpcID,p,hisname,histitle,"MuonCSize_H","Muon cluster size");
+        MuonCSize_H.rpc[i] = new TH1F(hisname, histitle, 2, 0, 2);
+        MuonCSize_H.rpc[i]->SetOption("TEXT");
+        SetTH1(MuonCSize_H.rpc[i],"","");
+
+        //Corrected muon multiplicity
+        SetTitleName(rpcID,p,hisname,histitle,"MuonCMult_H","Muon cluster multiplicity");
+        MuonCMult_H.rpc[i] = new TH1F(hisname, histitle, 2, 0, 2);
+        MuonCMult_H.rpc[i]->SetOption("TEXT");
+        SetTH1(MuonCMult_H.rpc[i],"","");
+    }
+
+    //************** DATA ANALYSIS **********************************
+
+    //In case of old format files, the amount of corrupted data is
+    //estimated out of a skew fit of the hit multiplicity. The fits
+    //of all the partitions are done at once, shared by the threads,
+    //and saved into a cache in the scan directory for later runs
+    //unless the results are only temporary.
+    GIFSkewArray Skews;
+
+    if(!isNewFormat){
+        string cacheName = "";
+        if(options.SaveFits)
+            cacheName = baseName.substr(0,baseName.find_last_of("/")) + __skewcache;
+
+        FitMultiplicities(HitMultiplicity_H,nBinsMult,options.nThreads,cacheName,Skews);
+    }
+
+    //Results of every partition. The partitions don't share any
+    //histogram : they are analysed independently, possibly by
+    //several threads at once, and their results are only written
+    //into the output files afterwards, in the order of the partitions.
+    vector<PartitionResults> Results(nPartitions);
+
+    auto AnalysePartition = [&](Uint i, PeakFinder& Finder){
+        const PartitionInfo& part = Parts->GetInfo(i);
+        Uint   p           = part.Partition;
+        Uint   nStripsPart = part.nStrips;
+        PartitionResults& R = Results[i];
+
+        //**************** CORRUPTED DATA ESTIMATION **********************************
+
+        //In case of old format files (no quality flag), it is need to estimate
+        //the amount of corrupted data via a fit as the corrupted data will
+        //always fill events with a fake "0 multiplicity". Indeed, at first,
+        //as this problem was believed to be small and negligible, no good
+        //was put in trying to reject it directly using a quality flag. 2017
+        //data showed us otherwise.
+        int nEmptyEvent = 0;
+        int nPhysics = 0;
+
+        if(!isNewFormat){
+            //The multiplicity was fitted using first a gaussian
+            //that is used to get parameter initialisation for a skew fit (it
+            //works better to first fit with a gaussian).
+            //BUT! the fit will hardly work in the case the mean of the distribution
+            //is low and close to 0. To check that the fit worked, we will compare
+            //the value given by the fit for multiplicity 1 (x=1) and ask for a
+            //variation of less than 1% with respect to the data.
+            //(see FitMultiplicities(...) before the analysis of the partitions)
+
+            //Check that the fit worked:
+            //  - make sure fit gives a value close enough to multiplicity = 1 bin
+            //(variation of less than 1% with respect to the data)
+            //  - make sure there is enough statistics (most of the data is not
+            //contained in multiplicity 0 bin)
+            //Then, if the fit is good but the value of the fit for multiplicity
+            //0 is higher than the content of the data bin, keep the number of empty
+            //events to 0 to make sure it does not turn negative.
+
+            double fitValue = EvalSkew(Skews.rpc[i],1);
+            double dataValue = (double)HitMultiplicity_H.rpc[i]->GetBinContent(2);
+            double difference = TMath::Abs(dataValue - fitValue);
+            double fitTOdataVSentries_ratio = difference / (double)nEntries;
+            bool isFitGOOD = fitTOdataVSentries_ratio < 0.01;
+
+            double nSinglehit = (double)HitMultiplicity_H.rpc[i]->GetBinContent(1);
+            double lowMultRatio = nSinglehit / (double)nEntries;
+            bool isMultLOW = lowMultRatio > 0.4;
+
+            if(isFitGOOD && !isMultLOW){
+                nEmptyEvent = HitMultiplicity_H.rpc[i]->GetBinContent(1);
+                nPhysics = (int)EvalSkew(Skews.rpc[i],0);
+                if(nPhysics < nEmptyEvent)
+                    nEmptyEvent = nEmptyEvent-nPhysics;
+            }
+        }
+
+        //Percentage of corrupted data
+        R.CorruptRatio = 100.*(double)nEmptyEvent / (double)nEntries;
+
+        //**************** RATE CALCULATION / NOISE HISTO RESCALING *******************
+
+        //Get the mean noise on the strips and chips using the noise hit
+        //profile. Normalise the number of hits in each bin by the integrated
+        //time and the strip sruface (counts/s/cm2).
+        float rate_norm = 0.;
+
+        //Now we can proceed with getting the number of noise/gamma hits
+        //and convert it into a noise/gamma rate per unit area.
+        //Get the number of noise hits
+        int nNoise = StripNoiseProfile_H.rpc[i]->GetEntries();
+
+        //Get the strip geometry
+        float stripArea = part.StripArea;
+
+        if(Mode == EFFICIENCY){
+            float noiseWindow = BMTDCWINDOW - TIMEREJECT - 2*PeakWidth.rpc[i];
+            rate_norm = (nEntries-nEmptyEvent)*noiseWindow*1e-9*stripArea;
+        } else
+            rate_norm = (nEntries-nEmptyEvent)*RDMNOISEWDW*1e-9*stripArea;
+
+        //Get the average number of hits per strip to normalise the activity
+        //histogram (this number is the same for both Strip and Chip histos).
+        float averageNhit = (nNoise>0) ? (float)(nNoise/nStripsPart) : 1.;
+
+        for(Uint st = 1; st <= nStripsPart; st++){
+            //Get profit of the loop over strips to subtract the
+            //average background from the beam profile. This average
+            //calculated strip by strip is obtained using a proportionnality
+            //rule on the number of hits measured during the noise
+            //window and the time width of the peak
+            if(Mode == EFFICIENCY){
+                int nNoiseHits = StripNoiseProfile_H.rpc[i]->GetBinContent(st);
+                float noiseWindow = BMTDCWINDOW - TIMEREJECT - 2*PeakWidth.rpc[i];
+                float peakWindow = 2*PeakWidth.rpc[i];
+                float nNoisePeak = nNoiseHits*peakWindow/noiseWindow;
+
+                int nPeakHits = BeamProfile_H.rpc[i]->GetBinContent(st);
+
+                float correctedContent = (nPeakHits<nNoisePeak) ? 0. : (float)nPeakHits-nNoisePeak;
+                BeamProfile_H.rpc[i]->SetBinContent(st,correctedContent);
+            }
+
+            //Get full RPCCh info usinf format TSCCC
+            Uint RPCCh = part.TrolleyID*1e4 + part.SlotID*1e3 + st + p*nStripsPart;
+
+            //Fill noise rates and activities, and apply mask
+            float stripRate = StripNoiseProfile_H.rpc[i]->GetBinContent(st)/rate_norm;
+            float stripAct = StripNoiseProfile_H.rpc[i]->GetBinContent(st)/averageNhit;
+
+            if(RPCChMap->GetMask(RPCCh) == ACTIVE){
+                StripNoiseProfile_H.rpc[i]->SetBinContent(st,stripRate);
+                StripActivity_H.rpc[i]->SetBinContent(st,stripAct);
+            } else if (RPCChMap->GetMask(RPCCh) == MASKED){
+                StripNoiseProfile_H.rpc[i]->SetBinContent(st,0.);
+                StripActivity_H.rpc[i]->SetBinContent(st,0.);
+                MaskNoiseProfile_H.rpc[i]->SetBinContent(st,stripRate);
+                MaskActivity_H.rpc[i]->SetBinContent(st,stripAct);
+            }
+        }
+
+        for(Uint ch = 0; ch < (nStripsPart/NSTRIPSCHIP); ch++){
+            //The chip rate and activity only iare incremented by a rate
+            //that is normalised to the number of active strip per chip
+            ChipMeanNoiseProf_H.rpc[i]->SetBinContent(ch+1,GetChipBin(StripNoiseProfile_H.rpc[i],ch));
+            ChipActivity_H.rpc[i]->SetBinContent(ch+1,GetChipBin(StripActivity_H.rpc[i],ch));
+        }
+
+        //Mean noise rate, cluster size, multiplicity and cluster
+        //rate of the partition
+        R.MeanPartRate = GetTH1Mean(StripNoiseProfile_H.rpc[i]);
+        R.cSizePart = NoiseCSize_H.rpc[i]->GetMean();
+        R.cSizePartErr = (NoiseCSize_H.rpc[i]->GetEntries() == 0)
+                ? 0.
+                : 2*NoiseCSize_H.rpc[i]->GetStdDev()/sqrt(NoiseCSize_H.rpc[i]->GetEntries());
+        R.cMultPart = NoiseCMult_H.rpc[i]->GetMean();
+        R.cMultPartErr = (NoiseCMult_H.rpc[i]->GetEntries() == 0)
+                ? 0.
+                : 2*NoiseCMult_H.rpc[i]->GetStdDev()/sqrt(NoiseCMult_H.rpc[i]->GetEntries());
+        R.ClustPartRate = (R.cSizePart==0)
+                ? 0.
+                : R.MeanPartRate/R.cSizePart;
+        R.ClustPartRateErr = (R.cSizePart==0)
+                ? 0.
+                : R.ClustPartRate * R.cSizePartErr/R.cSizePart;
+
+        //Get the partition homogeneity defined as exp(RMS(noise)/MEAN(noise))
+        //The closer the homogeneity is to 1 the more homogeneus, the closer
+        //the homogeneity is to 0 the less homogeneous.
+        //This gives idea about noisy strips and dead strips.
+        float MeanPartSDev = GetTH1StdDev(StripNoiseProfile_H.rpc[i]);
+        float strip_homog = (R.MeanPartRate==0)
+                ? 0.
+                : exp(-MeanPartSDev/R.MeanPartRate);
+        StripHomogeneity_H.rpc[i]->Fill("exp -#left(#frac{#sigma_{Strip Rate}}{#mu_{Strip Rate}}#right)",strip_homog);
+        StripHomogeneity_H.rpc[i]->GetYaxis()->SetRangeUser(0.,1.);
+
+        //Same thing for the chip level - need to get the RMS at the chip level, the mean stays the same
+        float ChipStDevMean = GetTH1StdDev(ChipMeanNoiseProf_H.rpc[i]);
+
+        float chip_homog = (R.MeanPartRate==0)
+                ? 0.
+                : exp(-ChipStDevMean/R.MeanPartRate);
+        ChipHomogeneity_H.rpc[i]->Fill("exp -#left(#frac{#sigma_{Chip Rate}}{#mu_{Chip Rate}}#right)",chip_homog);
+        ChipHomogeneity_H.rpc[i]->GetYaxis()->SetRangeUser(0.,1.);
+
+        if(Mode != EFFICIENCY) return;
+
+        //******************************* Print the peak gaussian
+        float lowlimit = PeakTime.rpc[i]-PeakWidth.rpc[i];
+        float highlimit = PeakTime.rpc[i]+PeakWidth.rpc[i];
+
+        //Get the curve on the histogram
+        PeakParams peak = Finder.Find(TimeProfile_H.rpc[i],lowlimit,highlimit);
+        Finder.Draw(TimeProfile_H.rpc[i],peak,lowlimit,highlimit);
+
+        //**************** EFFICIENCY/MUON CLUSTER SIZE/MULTIPLICITY ****************
+
+        //For each cases, evaluate the proportion of noise that
+        //contributes to the efficiency thanks to the peak and
+        //fake efficiency evaluation. Then, the peak efficiency
+        //is the probability to have at least 1 muon hit OR 1
+        //fake hit P(mu OR fake). The probability to have fake
+        //hits contributing to the efficiency is simply P(fake)
+        //measured by the fake efficiency histogram. Finally,
+        //using probabilities, we can say that:
+        //P(mu OR fake) = P(peak) = P(mu)+P(fake)-P(mu)*P(fake)
+        //using that the probability of the union is the sum of
+        //the individual probabilities minus the probability of
+        //the intersection. In the end, we have:
+        //P(mu) = (P(peak)-P(fake))/(1-P(fake))
+        //Each P as a binomial error:
+        //dP = SQRT(P*(1-P)/N)
+        float P_peak = EfficiencyPeak_H.rpc[i]->GetMean();
+        float P_fake = EfficiencyFake_H.rpc[i]->GetMean();
+        float P_muon = (P_peak-P_fake)/(1-P_fake);
+        float P_both = P_muon*P_fake;
+        float P_peak_err = sqrt(P_peak*(1.-P_peak)/nEntries);
+        float P_fake_err = sqrt(P_fake*(1.-P_fake)/nEntries);
+        float P_muon_err = sqrt(P_muon*(1.-P_muon)/nEntries);
+        float P_both_err = sqrt(P_both*(1.-P_both)/nEntries);
+
+        //In the same way, probing the probabilities to have
+        //events with muon alone, fake alone or both, it is
+        //possible to get the real muon cluster size.
+        //P(peak) = P(mu)+P(fake)-P(mu&&fake)
+        //1 = F(mu) + F(fake) + F(mu&&fake) where F are the
+        //fractions of each cases, 1 being all the cases. The
+        //fractions F, expressed with the corresponding P are
+        //F = P/P(peak) = P/P(mu||fake).
+        //Which give the following error for the fractions F:
+        //dF = F*(dP/P+dP(peak)/P(peak))
+        //The cluster size measured is then:
+        //Cpeak = Cmu*F(mu)+Cfake*F(fake)+(Cmu+Cfake)*F(mu&&fake)/2
+        //assuming the cluster size in case where both muon and
+        //fake are seen is the average of both. Leading to:
+        //Cmu = (Cpeak-Cfake*(F(fake)+F(mu&&fake)/2))/(F(mu)+F(fake)/2)
+        //The errors on Cpeak and Cfake corresponds to their
+        //respective histograms statistical error:
+        //dC = 2*STDV(C)/SQRT(N)
+        //All this will help getting the error propagation to Cmu
+
+        float F_both = P_both/P_peak;
+        float F_muon = (P_muon-P_both)/P_peak;
+        float F_fake = (P_fake-P_both)/P_peak;
+        float F_both_err = F_both*(P_both_err/P_both+P_peak_err/P_peak);
+        float F_muon_err = (P_muon_err+F_both_err+F_muon*P_peak_err)/P_peak;
+        float F_fake_err = (P_fake_err+F_both_err+F_fake*P_peak_err)/P_peak;
+
+        float CS_peak = PeakCSize_H.rpc[i]->GetMean();
+        float CS_fake = NoiseCSize_H.rpc[i]->GetMean();
+        float CS_peak_err = 2*PeakCSize_H.rpc[i]->GetStdDev()/sqrt(PeakCSize_H.rpc[i]->GetEntries());
+        float CS_fake_err = 2*NoiseCSize_H.rpc[i]->GetStdDev()/sqrt(NoiseCSize_H.rpc[i]->GetEntries());
+
+        float CS_muon = (CS_peak-CS_fake*(F_fake+F_both/2.))/(F_muon+F_both/2.);
+        float CS_muon_err = (CS_peak_err
+                             +(F_fake+F_both/2.)*CS_fake_err
+                             +CS_muon*F_muon_err
+                             +CS_fake*(F_fake_err+F_both_err/2.))
+                            /(F_muon+F_both/2.);
+
+        //Finally get the muon cluster multiplicity based on the
+        //asumption that the average peak multiplicity is the sum
+        //of the muon and fakes.
+        //Mpeak = Mmu + Mfake so Mmu = Mpeak - Mfake
+        //The fake multiplicity is simply the background one but
+        //normalized to the peak time window.
+        //The errors on Mpeak and Mfake corresponds to their
+        //respective histograms statistical error:
+        //dM = 2*STDV(M)/SQRT(N)
+        //All this will help getting the error propagation to Mmu
+        float noiseWindow = BMTDCWINDOW - TIMEREJECT - 2*PeakWidth.rpc[i];
+        float peakWindow = 2*PeakWidth.rpc[i];
+
+        float CM_peak = PeakCMult_H.rpc[i]->GetMean();
+        float CM_fake = NoiseCMult_H.rpc[i]->GetMean() * peakWindow/noiseWindow;
+        float CM_muon = CM_peak-CM_fake;
+
+        float CM_peak_err = 2*PeakCMult_H.rpc[i]->GetStdDev()/sqrt(PeakCMult_H.rpc[i]->GetEntries());
+        float CM_fake_err = 2*NoiseCMult_H.rpc[i]->GetStdDev()/sqrt(NoiseCMult_H.rpc[i]->GetEntries())
+                            * peakWindow/noiseWindow;
+        float CM_muon_err = CM_peak_err + CM_fake_err;
+
+        //Results for the output CSV file
+        R.P_muon      = P_muon;
+        R.P_muon_err  = P_muon_err;
+        R.CS_muon     = CS_muon;
+        R.CS_muon_err = CS_muon_err;
+        R.CM_peak     = CM_peak;
+        R.CM_peak_err = CM_peak_err;
+
+        //Fill L0 efficiency histogram
+        Efficiency0_H.rpc[i]->Fill("muon efficiency",P_muon);
+        Efficiency0_H.rpc[i]->Fill("muon efficiency error",P_muon_err);
+        Efficiency0_H.rpc[i]->GetYaxis()->SetRangeUser(0.,1.);
+
+        //Fill L0 muon cluster size histogram
+        MuonCSize_H.rpc[i]->Fill("muon cluster size",CS_muon);
+        MuonCSize_H.rpc[i]->Fill("muon cluster size error",CS_muon_err);
+
+        //Fill L0 muon cluster multiplicity histogram
+        MuonCMult_H.rpc[i]->Fill("muon cluster multiplicity",CM_muon);
+        MuonCMult_H.rpc[i]->Fill("muon cluster multiplicity error",CM_muon_err);
+    };
+
+    Uint nTasks = options.nThreads;
+    if(nTasks > nPartitions) nTasks = nPartitions;
+
+    //The peak fits always use the minimizer of the parallel fits so
+    //that the curves don't depend on the number of threads
+    string minimizer, algorithm;
+    EnableParallelFits(minimizer,algorithm);
+
+    if(nTasks <= 1){
+        //Gives the muon peak curves drawn on the time profiles
+        PeakFinder Finder;
+
+        for(Uint i = 0; i < nPartitions; i++)
+            AnalysePartition(i,Finder);
+    } else {
+        MSG_INFO("[Analysis] Partitions analysed by " + intToString(nTasks) + " threads");
+
+        //Each thread picks the partitions one after the other and
+        //has its own finder (the fit function can't be shared)
+        atomic<Uint> next(0);
+        vector<thread> Tasks;
+
+        for(Uint t = 0; t < nTasks; t++){
+            Tasks.push_back(thread([&](){
+                PeakFinder Finder;
+
+                for(Uint i = next++; i < nPartitions; i = next++)
+                    AnalysePartition(i,Finder);
+            }));
+        }
+
+        for(Uint t = 0; t < nTasks; t++)
+            Tasks[t].join();
+    }
+
+    RestoreMinimizer(minimizer,algorithm);
+
+    //************** OUTPUT FILES ***********************************
+
+    //create a ROOT output file to save the histograms
+    TFile outputfile(rootName.c_str(), "recreate");
+
+    //The CSV headers and rows are first written into output
+    //********************************* Rate
+    //list of parameters saved into the Offline-Rate.csv file
+    //(Offline-Rate-Header.csv)
+    ostringstream headRateCSV;
+    headRateCSV << "HVstep\t";
+
+    //output Rate csv row
+    ostringstream outputRateCSV;
+    //Print the HV step as first column
+    outputRateCSV << HVstep << '\t';
+
+    //********************************* Corrupted data
+    //percentage of corrupted data (Offline-Corrupted-Header.csv
+    //and Offline-Corrupted.csv)
+    ostringstream headCorrCSV;
+    headCorrCSV << "HVstep\t";
+
+    ostringstream outputCorrCSV;
+    //Print the HV step as first column
+    outputCorrCSV << HVstep << '\t';
+
+    //********************************* Efficiency, muon cluster
+    //list of parameters saved into the Offline-L0-EffCl.csv file
+    //(Offline-L0-EffCl-Header.csv)
+    ostringstream headEffCSV;
+    headEffCSV << "HVstep\t";
+
+    //output csv row
+    ostringstream outputEffCSV;
+    //Print the HV step as first column
+    outputEffCSV << HVstep << '\t';
+
+    //Loop over the RPCs
+    for (Uint rpc = 0; rpc < Parts->GetNRPCs(); rpc++){
+        //Get the total chamber rate
+        //we need to now the total chamber surface (sum active areas)
+        float RPCarea       = 0.;
+        float MeanNoiseRate = 0.;
+        float ClusterRate   = 0.;
+        float ClusterSDev   = 0.;
+
+        for (Uint i = Parts->GetFirst(rpc); i < Parts->GetLast(rpc); i++){
+            const PartitionInfo& part = Parts->GetInfo(i);
+            Uint   nStripsPart = part.nStrips;
+            float  stripArea   = part.StripArea;
+            string partName    = part.Name;
+            const PartitionResults& R = Results[i];
+
+            //Write the corrupted header file. This file will still be writen
+            //even after the new file format has been used.
+            headCorrCSV << "Corr-" << partName << "\t";
+
+            //Print the percentage of corrupted data
+            outputCorrCSV << R.CorruptRatio << '\t';
+
+            //Write the rate header file
+            headRateCSV <<   "Rate-" << partName << "\t"
+                        <<    "ClS-" << partName << "\t"
+                        <<    "ClS-" << partName << "_Err\t"
+                        <<    "ClM-" << partName << "\t"
+                        <<    "ClM-" << partName << "_Err\t"
+                        << "ClRate-" << partName << "\t"
+                        << "ClRate-" << partName << "_Err\t";
+
+            //Write in the output file the mean noise rate per
+            //partition
+            outputRateCSV << R.MeanPartRate << '\t'
+                          << R.cSizePart << '\t' << R.cSizePartErr << '\t'
+                          << R.cMultPart << '\t' << R.cMultPartErr << '\t'
+                          << R.ClustPartRate << '\t' << R.ClustPartRateErr << '\t';
+
+            //Push the partition results into the chamber level
+            RPCarea       += stripArea * nStripsPart;
+            MeanNoiseRate += R.MeanPartRate * stripArea * nStripsPart;
+            ClusterRate   += R.ClustPartRate * stripArea * nStripsPart;
+            ClusterSDev   += (R.cSizePart==0)
+                    ? 0.
+                    : ClusterRate*R.cSizePartErr/R.cSizePart;
+
+            //Draw and write the histograms into the output ROOT file
+            //******************************* General histograms
+
+            TimeProfile_H.rpc[i]->Write();
+            HitProfile_H.rpc[i]->Write();
+            HitMultiplicity_H.rpc[i]->Write();
+            TimeVSChanProfile_H.rpc[i]->Write();
+
+            //******************************* Strip granularity histograms
+
+            StripNoiseProfile_H.rpc[i]->Write();
+            StripActivity_H.rpc[i]->Write();
+            StripHomogeneity_H.rpc[i]->Write();
+            MaskNoiseProfile_H.rpc[i]->Write();
+            MaskActivity_H.rpc[i]->Write();
+            NoiseCSize_H.rpc[i]->Write();
+            NoiseCMult_H.rpc[i]->Write();
+
+            //******************************* Chip granularity histograms
+
+            ChipMeanNoiseProf_H.rpc[i]->Write();
+            ChipActivity_H.rpc[i]->Write();
+            ChipHomogeneity_H.rpc[i]->Write();
+
+            //**************** EFFICIENCY/MUON CLUSTER SIZE/MULTIPLICITY ****************
+
+            if(Mode == EFFICIENCY){
+                //Write the efficiency/cluster header file
+                headEffCSV << "Eff-" << partName << '\t'
+                           << "Eff-" << partName << "_Err\t"
+                           << "ClS-" << partName << '\t'
+                           << "ClS-" << partName << "_Err\t"
+                           << "ClM-" << partName << '\t'
+                           << "ClM-" << partName << "_Err\t";
+
+                //Write in the output CSV file
+                outputEffCSV << R.P_muon << '\t' << R.P_muon_err << '\t'
+                             << R.CS_muon << '\t' << R.CS_muon_err << '\t'
+                             << R.CM_peak << '\t' << R.CM_peak_err << '\t';
+
+                //******************************* muon histograms
+
+                BeamProfile_H.rpc[i]->Write();
+                EfficiencyFake_H.rpc[i]->Write();
+                EfficiencyPeak_H.rpc[i]->Write();
+                PeakCSize_H.rpc[i]->Write();
+                PeakCMult_H.rpc[i]->Write();
+                Efficiency0_H.rpc[i]->Write();
+                MuonCSize_H.rpc[i]->Write();
+                MuonCMult_H.rpc[i]->Write();
+            }
+        }
+
+        //Finalise the calculation of the chamber rate
+        MeanNoiseRate /= RPCarea;
+        ClusterRate   /= RPCarea;
+        ClusterSDev   /= RPCarea;
+
+        //Write the header file
+        string rpcID = Parts->GetRPCName(rpc);
+        headRateCSV << "Rate-" << rpcID << "-TOT\t"
+                    << "ClRate-" << rpcID << "-TOT\t"
+                    << "ClRate-" << rpcID << "-TOT_Err\t";
+
+        //Write the output file
+        outputRateCSV << MeanNoiseRate << '\t'
+                      << ClusterRate << '\t' << ClusterSDev << '\t';
+    }
+    //End the CSV lines
+    headRateCSV << '\n';
+    outputRateCSV << '\n';
+    headCorrCSV << '\n';
+    outputCorrCSV << '\n';
+    headEffCSV << '\n';
+    outputEffCSV << '\n';
+
+    output.HeadRate = headRateCSV.str();
+    output.RowRate = outputRateCSV.str();
+    output.HeadCorr = headCorrCSV.str();
+    output.RowCorr = outputCorrCSV.str();
+    output.HeadEff = headEffCSV.str();
+    output.RowEff = outputEffCSV.str();
+
+    outputfile.Close();
+
+    //Free the histograms
+    DeleteHistos(TimeProfile_H);
+    DeleteHistos(HitProfile_H);
+    DeleteHistos(HitMultiplicity_H);
+    DeleteHistos(TimeVSChanProfile_H);
+
+    DeleteHistos(StripNoiseProfile_H);
+    DeleteHistos(StripActivity_H);
+    DeleteHistos(StripHomogeneity_H);
+    DeleteHistos(MaskNoiseProfile_H);
+    DeleteHistos(MaskActivity_H);
+    DeleteHistos(NoiseCSize_H);
+    DeleteHistos(NoiseCMult_H);
+
+    DeleteHistos(ChipMeanNoiseProf_H);
+    DeleteHistos(ChipActivity_H);
+    DeleteHistos(ChipHomogeneity_H);
+
+    DeleteHistos(BeamProfile_H);
+    DeleteHistos(EfficiencyFake_H);
+    DeleteHistos(EfficiencyPeak_H);
+    DeleteHistos(PeakCSize_H);
+    DeleteHistos(PeakCMult_H);
+    DeleteHistos(Efficiency0_H);
+    DeleteHistos(MuonCSize_H);
+    DeleteHistos(MuonCMult_H);
+
+}
+
+// ****************************************************************************************************
+// *    bool AnalyseStep(string baseName, AnalysisOptions& options, AnalysisSetup& setup,
+// *                     AnalysisOutput& output)
+//
+//  Analyses the content of baseName_DAQ.root with the tables of setup, writes the histograms into
+//  baseName_Offline.root and the CSV headers and rows into output. Returns false if the DAQ file
+//  couldn't be opened. Several HV steps can be analysed at once since setup is only read, as long as
+//  the histograms are kept out of ROOT's directories (TH1::AddDirectory(false)).
+// ****************************************************************************************************
+
+bool AnalyseStep(string baseName, AnalysisOptions& options, AnalysisSetup& setup,
+                 AnalysisOutput& output){
+    LoopResults Results;
+
+    if(!RunLoop(baseName,options,setup,0,ALLENTRIES,Results))
+        return false;
+
+    FinishStep(baseName,options,setup,Results,baseName + "_Offline.root",output);
+    return true;
+}
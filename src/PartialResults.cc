@@ -0,0 +1,591 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    PartialResults.cc
+// *
+// *    Analysis of a HV step split over several processes or
+// *    machines. Each process loops over a range of entries of
+// *    the DAQ file and saves its raw loop results into a
+// *    partial file. The partial files are then merged and the
+// *    rest of the analysis (fits, CSV files, ROOT file) is run
+// *    once on the merged results.
+// *    The muon peak of an efficiency run is searched once and
+// *    saved into a peak file read by all the partials.
+// *    The same files are used as checkpoints of a long loop so
+// *    that an interrupted analysis can be resumed.
+//***************************************************************
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "TH1.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TUUID.h"
+
+#include "../include/PartialResults.h"
+#include "../include/MsgSvc.h"
+#include "../include/types.h"
+#include "../include/utils.h"
+
+using namespace std;
+
+//Identifier written at the beginning of every partial file
+static const char PARTIALMAGIC[8] = {'G','I','F','P','A','R','T','\0'};
+
+//Identifier written at the beginning of every peak file
+static const char PEAKMAGIC[8] = {'G','I','F','P','E','A','K','\0'};
+
+// ****************************************************************************************************
+// *    string GetPartialName(string baseName, Uint first, Uint last)
+//
+//  Returns the name of the partial file of the entries [first,last[ of baseName_DAQ.root.
+// ****************************************************************************************************
+
+string GetPartialName(string baseName, Uint first, Uint last){
+    return baseName + __partial + longTostring(first) + "-" + longTostring(last) + __partialext;
+}
+
+// ****************************************************************************************************
+// *    void SaveFamily(ostream& out, const PartitionArray<X>& family)
+// *    bool LoadFamily(istream& in, PartitionArray<X>& family, Uint nPartitions)
+//
+//  Writes / reads the accumulators or counters of every partition of a family of loop histograms.
+// ****************************************************************************************************
+
+template<typename X>
+static void SaveFamily(ostream& out, const PartitionArray<X>& family){
+    for(Uint i = 0; i < family.size(); i++)
+        family.rpc[i].Save(out);
+}
+
+template<typename X>
+static bool LoadFamily(istream& in, PartitionArray<X>& family, Uint nPartitions){
+    family.rpc.assign(nPartitions,X());
+
+    for(Uint i = 0; i < nPartitions; i++)
+        if(!family.rpc[i].Load(in)) return false;
+
+    return true;
+}
+
+// ****************************************************************************************************
+// *    void SavePeak(ostream& out, const muonPeak& peak)
+// *    bool LoadPeak(istream& in, muonPeak& peak, Uint nPartitions)
+//
+//  Writes / reads a muon peak parameter of every partition.
+// ****************************************************************************************************
+
+static void SavePeak(ostream& out, const muonPeak& peak){
+    out.write((const char*)peak.rpc.data(),peak.size()*sizeof(float));
+}
+
+static bool LoadPeak(istream& in, muonPeak& peak, Uint nPartitions){
+    peak = muonPeak(nPartitions,0.);
+    in.read((char*)peak.rpc.data(),nPartitions*sizeof(float));
+
+    return !in.fail();
+}
+
+// ****************************************************************************************************
+// *    void GetPartialKeys(const vector<string>& daqNames, string mappath, string dimpath,
+// *                        Uint nEntries, Uint nPartitions, HitCacheKeys& keys)
+//
+//  Gets the keys of the partial, peak and checkpoint files of a run. Contrary to the hit cache, these
+//  files are often merged on another machine than the one that made them, where the copies of the
+//  DAQ files have another modification time. The DAQ files are then identified by the UUID ROOT
+//  gave them when they were created and by the number of entries of their RAWData tree.
+// ****************************************************************************************************
+
+void GetPartialKeys(const vector<string>& daqNames, string mappath, string dimpath,
+                    Uint nEntries, Uint nPartitions, HitCacheKeys& keys){
+    GetHitCacheKeys(daqNames,mappath,dimpath,nEntries,nPartitions,keys);
+
+    keys.DAQKey = 14695981039346656037ULL;
+
+    for(Uint f = 0; f < daqNames.size(); f++){
+        UChar_t uuid[16];
+        memset(uuid,0,sizeof(uuid));
+        unsigned long long fileEntries = 0;
+
+        TFile file(daqNames[f].c_str());
+
+        if(file.IsOpen()){
+            file.GetUUID().GetUUID(uuid);
+
+            TTree* tree = (TTree*)file.Get("RAWData");
+            if(tree != NULL) fileEntries = tree->GetEntries();
+
+            file.Close();
+        }
+
+        for(Uint b = 0; b < sizeof(uuid); b++){
+            keys.DAQKey ^= uuid[b];
+            keys.DAQKey *= 1099511628211ULL;
+        }
+
+        keys.DAQKey ^= fileEntries;
+        keys.DAQKey *= 1099511628211ULL;
+    }
+}
+
+// ****************************************************************************************************
+// *    bool SameKeys(const HitCacheKeys& a, const HitCacheKeys& b)
+//
+//  Tells if two partial files were made from the same DAQ file, mapping and geometry.
+// ****************************************************************************************************
+
+static bool SameKeys(const HitCacheKeys& a, const HitCacheKeys& b){
+    return a.DAQKey == b.DAQKey
+        && a.MappingKey == b.MappingKey
+        && a.DimensionsKey == b.DimensionsKey
+        && a.nEntries == b.nEntries
+        && a.nPartitions == b.nPartitions;
+}
+
+// ****************************************************************************************************
+// *    bool WritePartial(string fileName, const HitCacheKeys& keys, LoopResults& R)
+//
+//  Saves the loop results R into the partial file fileName along with the keys of the DAQ file,
+//  mapping and geometry they were obtained with. As for the hit cache, the file is first written
+//  under a temporary name and then renamed. The temporary file is read back before being renamed so
+//  that a partial that can't be merged is never left behind. Returns false if the file couldn't be
+//  written.
+// ****************************************************************************************************
+
+bool WritePartial(string fileName, const HitCacheKeys& keys, LoopResults& R){
+    PartialHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.Magic,PARTIALMAGIC,sizeof(PARTIALMAGIC));
+
+    header.Version = PARTIALVERSION;
+    header.Mode = R.Mode;
+    header.isNewFormat = R.isNewFormat;
+    header.First = R.First;
+    header.Last = R.Last;
+    header.Keys = keys;
+
+    string tmpName = fileName + "." + intToString(getpid());
+    ofstream partialFile(tmpName.c_str(), ios::out | ios::binary);
+
+    partialFile.write((const char*)&header,sizeof(header));
+
+    SavePeak(partialFile,R.PeakHeight);
+    SavePeak(partialFile,R.PeakTime);
+    SavePeak(partialFile,R.PeakWidth);
+
+    GIFLoopHistos& H = R.LoopH;
+
+    SaveFamily(partialFile,H.TimeProfile);
+    SaveFamily(partialFile,H.HitProfile);
+    SaveFamily(partialFile,H.HitMultiplicity);
+    SaveFamily(partialFile,H.TimeVSChanProfile);
+    SaveFamily(partialFile,H.StripNoiseProfile);
+    SaveFamily(partialFile,H.NoiseCSize);
+    SaveFamily(partialFile,H.NoiseCMult);
+    SaveFamily(partialFile,H.BeamProfile);
+    SaveFamily(partialFile,H.EfficiencyFake);
+    SaveFamily(partialFile,H.EfficiencyPeak);
+    SaveFamily(partialFile,H.PeakCSize);
+    SaveFamily(partialFile,H.PeakCMult);
+
+    partialFile.close();
+
+    PartialHeader check;
+    LoopResults Check;
+
+    if(partialFile.fail() || !ReadPartial(tmpName,check,Check)
+       || rename(tmpName.c_str(),fileName.c_str()) != 0){
+        MSG_ERROR("[Offline] Could not save the partial results " + fileName);
+        remove(tmpName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// ****************************************************************************************************
+// *    bool ReadPartial(string fileName, PartialHeader& header, LoopResults& R)
+//
+//  Reads the header and the loop results of the partial file fileName. Returns false if the file
+//  doesn't exist, is not a partial file of the current version or is truncated.
+// ****************************************************************************************************
+
+bool ReadPartial(string fileName, PartialHeader& header, LoopResults& R){
+    ifstream partialFile(fileName.c_str(), ios::in | ios::binary);
+    if(!partialFile.is_open()) return false;
+
+    partialFile.read((char*)&header,sizeof(header));
+
+    if(partialFile.fail()
+       || memcmp(header.Magic,PARTIALMAGIC,sizeof(PARTIALMAGIC)) != 0
+       || header.Version != PARTIALVERSION
+       || header.First > header.Last
+       || header.Last > header.Keys.nEntries)
+        return false;
+
+    Uint nPartitions = header.Keys.nPartitions;
+
+    R.Mode = (header.Mode == EFFICIENCY) ? EFFICIENCY : RATE;
+    R.isNewFormat = header.isNewFormat;
+    R.nFileEntries = header.Keys.nEntries;
+    R.First = header.First;
+    R.Last = header.Last;
+
+    GIFLoopHistos& H = R.LoopH;
+
+    return LoadPeak(partialFile,R.PeakHeight,nPartitions)
+        && LoadPeak(partialFile,R.PeakTime,nPartitions)
+        && LoadPeak(partialFile,R.PeakWidth,nPartitions)
+        && LoadFamily(partialFile,H.TimeProfile,nPartitions)
+        && LoadFamily(partialFile,H.HitProfile,nPartitions)
+        && LoadFamily(partialFile,H.HitMultiplicity,nPartitions)
+        && LoadFamily(partialFile,H.TimeVSChanProfile,nPartitions)
+        && LoadFamily(partialFile,H.StripNoiseProfile,nPartitions)
+        && LoadFamily(partialFile,H.NoiseCSize,nPartitions)
+        && LoadFamily(partialFile,H.NoiseCMult,nPartitions)
+        && LoadFamily(partialFile,H.BeamProfile,nPartitions)
+        && LoadFamily(partialFile,H.EfficiencyFake,nPartitions)
+        && LoadFamily(partialFile,H.EfficiencyPeak,nPartitions)
+        && LoadFamily(partialFile,H.PeakCSize,nPartitions)
+        && LoadFamily(partialFile,H.PeakCMult,nPartitions);
+}
+
+// ****************************************************************************************************
+// *    bool WritePeakFile(string fileName, const HitCacheKeys& keys, LoopResults& R)
+//
+//  Saves the muon peak parameters of R into the peak file fileName along with the keys of the DAQ
+//  files, mapping and geometry they were obtained with. As for the partials, the file is written
+//  under a temporary name and then renamed. Returns false if the file couldn't be written.
+// ****************************************************************************************************
+
+bool WritePeakFile(string fileName, const HitCacheKeys& keys, LoopResults& R){
+    PartialHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.Magic,PEAKMAGIC,sizeof(PEAKMAGIC));
+
+    header.Version = PARTIALVERSION;
+    header.Mode = R.Mode;
+    header.isNewFormat = R.isNewFormat;
+    header.Keys = keys;
+
+    string tmpName = fileName + "." + intToString(getpid());
+    ofstream peakFile(tmpName.c_str(), ios::out | ios::binary);
+
+    peakFile.write((const char*)&header,sizeof(header));
+
+    SavePeak(peakFile,R.PeakHeight);
+    SavePeak(peakFile,R.PeakTime);
+    SavePeak(peakFile,R.PeakWidth);
+
+    peakFile.close();
+
+    if(peakFile.fail() || rename(tmpName.c_str(),fileName.c_str()) != 0){
+        MSG_WARNING("[Offline] Could not save the muon peak " + fileName);
+        remove(tmpName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// ****************************************************************************************************
+// *    bool ReadPeakFile(string fileName, const HitCacheKeys& keys, LoopResults& R)
+//
+//  Reads the muon peak parameters of the peak file fileName into R. The file is only used if it was
+//  made with the keys of the current DAQ files, mapping and geometry and with the run type and format
+//  of R. Otherwise, R is left untouched and false is returned.
+// ****************************************************************************************************
+
+bool ReadPeakFile(string fileName, const HitCacheKeys& keys, LoopResults& R){
+    if(access(fileName.c_str(),F_OK) != 0) return false;
+
+    ifstream peakFile(fileName.c_str(), ios::in | ios::binary);
+
+    PartialHeader header;
+    peakFile.read((char*)&header,sizeof(header));
+
+    Uint nPartitions = keys.nPartitions;
+    muonPeak PeakHeight, PeakTime, PeakWidth;
+
+    bool valid = !peakFile.fail()
+              && memcmp(header.Magic,PEAKMAGIC,sizeof(PEAKMAGIC)) == 0
+              && header.Version == PARTIALVERSION
+              && SameKeys(header.Keys,keys)
+              && header.Mode == (Uint)R.Mode
+              && header.isNewFormat == (Uint)R.isNewFormat
+              && LoadPeak(peakFile,PeakHeight,nPartitions)
+              && LoadPeak(peakFile,PeakTime,nPartitions)
+              && LoadPeak(peakFile,PeakWidth,nPartitions);
+
+    if(!valid){
+        MSG_WARNING("[Offline] Muon peak " + fileName + " out of date, the peak is searched again");
+        return false;
+    }
+
+    R.PeakHeight = PeakHeight;
+    R.PeakTime = PeakTime;
+    R.PeakWidth = PeakWidth;
+
+    return true;
+}
+
+// ****************************************************************************************************
+// *    void PeakAnalysis(string baseName, AnalysisOptions& options)
+//
+//  Searches the muon peak of the efficiency run baseName on all its entries and saves it into
+//  baseName_Peak.raw without looping over any entry. The partials of the run started afterwards
+//  read the peak from this file instead of each searching it again.
+// ****************************************************************************************************
+
+void PeakAnalysis(string baseName, AnalysisOptions& options){
+    string scanDir = baseName.substr(0,baseName.find_last_of("/"));
+
+    bool addDirectory = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(false);
+
+    AnalysisSetup setup;
+    LoadSetup(scanDir,setup);
+
+    LoopResults Results;
+
+    //The loop over no entry saves the peak file of the run
+    if(RunLoop(baseName,options,setup,0,0,Results) && Results.Mode != EFFICIENCY)
+        MSG_INFO("[Offline] " + baseName + " is a rate run without muon peak");
+
+    DeleteSetup(setup);
+
+    TH1::AddDirectory(addDirectory);
+}
+
+// ****************************************************************************************************
+// *    void PartialAnalysis(string baseName, AnalysisOptions& options, Uint firstEntry,
+// *                         Uint lastEntry)
+//
+//  Loops over the entries [firstEntry,lastEntry[ of the DAQ files of the run baseName and saves the
+//  raw loop results into baseName_Partial-first-last.raw. The muon peak of efficiency runs is
+//  searched once on the whole run and shared by all the partials through baseName_Peak.raw so that
+//  they use the same time windows.
+// ****************************************************************************************************
+
+void PartialAnalysis(string baseName, AnalysisOptions& options, Uint firstEntry, Uint lastEntry){
+    string scanDir = baseName.substr(0,baseName.find_last_of("/"));
+
+    bool addDirectory = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(false);
+
+    AnalysisSetup setup;
+    LoadSetup(scanDir,setup);
+
+    LoopResults Results;
+
+    if(RunLoop(baseName,options,setup,firstEntry,lastEntry,Results)){
+        vector<string> DAQFiles;
+        FindDAQFiles(baseName,DAQFiles);
+
+        HitCacheKeys keys;
+        GetPartialKeys(DAQFiles,setup.MapPath,setup.DimPath,Results.nFileEntries,
+                       setup.Parts->GetNPartitions(),keys);
+
+        string partialName = GetPartialName(baseName,Results.First,Results.Last);
+
+        if(WritePartial(partialName,keys,Results))
+            MSG_INFO("[Offline] Entries " + longTostring(Results.First) + " to "
+                     + longTostring(Results.Last) + " saved into " + partialName);
+    }
+
+    DeleteSetup(setup);
+
+    TH1::AddDirectory(addDirectory);
+}
+
+// ****************************************************************************************************
+// *    bool SortPartialsByFirst(const PartialFile& a, const PartialFile& b)
+//
+//  Sorting function of the partial files (header and file name) by first entry.
+// ****************************************************************************************************
+
+typedef pair<PartialHeader,string> PartialFile;
+
+static bool SortPartialsByFirst(const PartialFile& a, const PartialFile& b){
+    return a.first.First < b.first.First;
+}
+
+// ****************************************************************************************************
+// *    void MergeAnalysis(string baseName, AnalysisOptions& options)
+//
+//  Merges all the partial files baseName_Partial-first-last.raw and runs the rest of the analysis
+//  once on the merged results, as if the whole DAQ file had been looped over at once. The partials
+//  are merged following the order of their entries. Nothing is written if the partials were made
+//  with different DAQ files, mappings or geometries, with another mapping or geometry than the ones
+//  of the scan directory, or if they don't cover all the entries of the DAQ file exactly once.
+// ****************************************************************************************************
+
+void MergeAnalysis(string baseName, AnalysisOptions& options){
+    size_t slash = baseName.find_last_of("/");
+    string scanDir = baseName.substr(0,slash);
+    string listDir = (slash == string::npos) ? "." : scanDir;
+    string prefix = ((slash == string::npos) ? baseName : baseName.substr(slash+1)) + __partial;
+
+    //****************** PARTIAL FILES *******************************
+
+    vector<PartialFile> Partials;
+
+    DIR* directory = opendir(listDir.c_str());
+
+    if(directory != NULL){
+        struct dirent* entry;
+
+        while((entry = readdir(directory)) != NULL){
+            string name = entry->d_name;
+
+            if(name.size() <= prefix.size() + __partialext.size()) continue;
+            if(name.compare(0,prefix.size(),prefix) != 0) continue;
+            if(name.compare(name.size()-__partialext.size(),__partialext.size(),__partialext) != 0) continue;
+
+            string fileName = listDir + "/" + name;
+            PartialFile partial;
+            partial.second = fileName;
+
+            ifstream partialFile(fileName.c_str(), ios::in | ios::binary);
+            partialFile.read((char*)&partial.first,sizeof(PartialHeader));
+
+            if(partialFile.fail() || memcmp(partial.first.Magic,PARTIALMAGIC,sizeof(PARTIALMAGIC)) != 0){
+                MSG_WARNING("[Offline] " + fileName + " is not a partial file and is ignored");
+                continue;
+            }
+
+            Partials.push_back(partial);
+        }
+
+        closedir(directory);
+    }
+
+    if(Partials.empty()){
+        MSG_ERROR("[Offline] No partial file for run " + baseName);
+        return;
+    }
+
+    sort(Partials.begin(),Partials.end(),SortPartialsByFirst);
+
+    //****************** MERGING *************************************
+
+    bool addDirectory = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(false);
+
+    AnalysisSetup setup;
+    LoadSetup(scanDir,setup);
+
+    //The partials have to be made with the mapping and the geometry of
+    //the scan directory and, if they are there, with its DAQ files
+    vector<string> DAQFiles;
+    FindDAQFiles(baseName,DAQFiles);
+
+    HitCacheKeys keys;
+    GetPartialKeys(DAQFiles,setup.MapPath,setup.DimPath,Partials[0].first.Keys.nEntries,
+                   setup.Parts->GetNPartitions(),keys);
+
+    if(DAQFiles.empty()) keys.DAQKey = Partials[0].first.Keys.DAQKey;
+
+    LoopResults Results;
+    Uint expected = 0;
+    bool valid = true;
+
+    for(Uint p = 0; p < Partials.size() && valid; p++){
+        string fileName = Partials[p].second;
+        PartialHeader header;
+        LoopResults Partial;
+
+        if(!ReadPartial(fileName,header,(p == 0) ? Results : Partial)){
+            MSG_ERROR("[Offline] " + fileName + " could not be read");
+            valid = false;
+        } else if(!SameKeys(header.Keys,keys)){
+            MSG_ERROR("[Offline] " + fileName + " was made with another DAQ file, mapping or geometry");
+            valid = false;
+        } else if(header.First != expected){
+            MSG_ERROR("[Offline] Entries " + longTostring(expected) + " to "
+                      + longTostring(header.First) + " are missing or analysed twice (" + fileName + ")");
+            valid = false;
+        } else if(p > 0 && (Partial.Mode != Results.Mode
+                            || Partial.isNewFormat != Results.isNewFormat
+                            || Partial.PeakTime.rpc != Results.PeakTime.rpc
+                            || Partial.PeakWidth.rpc != Results.PeakWidth.rpc)){
+            MSG_ERROR("[Offline] " + fileName + " was analysed with other muon peak windows");
+            valid = false;
+        } else {
+            if(p > 0) MergeLoopHistos(Results.LoopH,Partial.LoopH);
+            expected = header.Last;
+        }
+    }
+
+    if(valid && expected != keys.nEntries){
+        MSG_ERROR("[Offline] Entries " + longTostring(expected) + " to "
+                  + longTostring(keys.nEntries) + " are missing");
+        valid = false;
+    }
+
+    if(valid){
+        MSG_INFO("[Offline] " + intToString(Partials.size()) + " partial files merged");
+
+        Results.Last = expected;
+
+        AnalysisOutput output;
+        FinishStep(baseName,options,setup,Results,baseName + "_Offline.root",output);
+        WriteOutput(scanDir,output);
+    } else
+        MSG_ERROR("[Offline] Skipping offline analysis");
+
+    DeleteSetup(setup);
+
+    TH1::AddDirectory(addDirectory);
+}
+
+// ****************************************************************************************************
+// *    string GetCheckpointName(string baseName, Uint first, Uint last)
+//
+//  Returns the name of the checkpoint of the loop over the entries [first,last[ of the run baseName.
+// ****************************************************************************************************
+
+string GetCheckpointName(string baseName, Uint first, Uint last){
+    return baseName + __checkpoint + longTostring(first) + "-" + longTostring(last) + __partialext;
+}
+
+// ****************************************************************************************************
+// *    bool ReadCheckpoint(string fileName, const HitCacheKeys& keys, LoopResults& R)
+//
+//  Reads the checkpoint fileName of the loop over the entries [R.First,R.Last[. The checkpoint is
+//  only used if it was made with the keys of the current DAQ files, mapping and geometry and with
+//  the run type and format of R. R then gets the loop histograms and the muon peak parameters of the
+//  checkpoint and R.Last the first entry not looped over yet. Otherwise, R is left untouched and
+//  false is returned.
+// ****************************************************************************************************
+
+bool ReadCheckpoint(string fileName, const HitCacheKeys& keys, LoopResults& R){
+    if(access(fileName.c_str(),F_OK) != 0) return false;
+
+    PartialHeader header;
+    LoopResults Checkpoint;
+
+    bool valid = ReadPartial(fileName,header,Checkpoint)
+              && SameKeys(header.Keys,keys)
+              && Checkpoint.Mode == R.Mode
+              && Checkpoint.isNewFormat == R.isNewFormat
+              && Checkpoint.First == R.First
+              && Checkpoint.Last <= R.Last;
+
+    if(!valid){
+        MSG_WARNING("[Offline] Checkpoint " + fileName + " out of date, the loop starts again");
+        return false;
+    }
+
+    R = Checkpoint;
+    return true;
+}
@@ -0,0 +1,171 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    PartitionTable.cc
+// *
+// *    Class that defines PartitionTable objects. The table
+// *    gives a dense index to every active partition of the
+// *    infrastructure (following the trolleys, then the slots
+// *    and finally the partitions) and keeps their names and
+// *    geometry so that the loops over the partitions don't
+// *    need to ask the infrastructure for them. The
+// *    PartitionArray containers are indexed the same way.
+//***************************************************************
+
+#include <string>
+#include <vector>
+
+#include "../include/PartitionTable.h"
+#include "../include/Infrastructure.h"
+#include "../include/MsgSvc.h"
+#include "../include/types.h"
+
+using namespace std;
+
+// ****************************************************************************************************
+// *    PartitionTable()
+//
+//  Default constructor. The table is empty.
+// ****************************************************************************************************
+
+PartitionTable::PartitionTable(){
+    RPCFirst.assign(1,0);
+    SlotFirst.assign(100,NOPARTITION);
+}
+
+// ****************************************************************************************************
+// *    PartitionTable(Infrastructure* Infra)
+//
+//  Constructor. Loops over the trolleys, slots and partitions of the infrastructure and numbers the
+//  partitions in that order. The RPCs with more than MAXPARTITIONS partitions can't be labelled and
+//  are kept without any partition.
+// ****************************************************************************************************
+
+PartitionTable::PartitionTable(Infrastructure* Infra){
+    //The trolley and slot IDs are single digits of the RPC
+    //channels (TSCCC) so that 10x10 slots can be addressed
+    SlotFirst.assign(100,NOPARTITION);
+
+    for(Uint tr = 0; tr < Infra->GetNTrolleys(); tr++){
+        Uint T = Infra->GetTrolleyID(tr);
+
+        for(Uint sl = 0; sl < Infra->GetNSlots(tr); sl++){
+            Uint S = Infra->GetSlotID(tr,sl);
+            Uint nPartitions = Infra->GetNPartitions(tr,sl);
+
+            if(nPartitions > MAXPARTITIONS){
+                MSG_ERROR("[Offline] " + Infra->GetName(tr,sl) + " has more than "
+                          + to_string(MAXPARTITIONS) + " partitions and is ignored");
+                nPartitions = 0;
+            }
+
+            if(T < 10 && S < 10 && nPartitions > 0)
+                SlotFirst[T*10+S] = Partitions.size();
+            RPCFirst.push_back(Partitions.size());
+            RPCNames.push_back(Infra->GetName(tr,sl));
+
+            for(Uint p = 0; p < nPartitions; p++){
+                PartitionInfo info;
+
+                info.TrolleyID  = T;
+                info.SlotID     = S;
+                info.Partition  = p;
+                info.RPC        = RPCFirst.size()-1;
+                info.nStrips    = Infra->GetNStrips(tr,sl);
+                info.FirstStrip = p*info.nStrips + 1;
+                info.StripArea  = Infra->GetStripGeo(tr,sl,p);
+                info.RPCName    = Infra->GetName(tr,sl);
+                info.Name       = info.RPCName + "-" + (char)('A'+p);
+
+                Partitions.push_back(info);
+            }
+        }
+    }
+
+    RPCFirst.push_back(Partitions.size());
+}
+
+// ****************************************************************************************************
+// *    ~PartitionTable()
+//
+//  Destructor
+// ****************************************************************************************************
+
+PartitionTable::~PartitionTable(){
+
+}
+
+// ****************************************************************************************************
+// *    Uint GetNPartitions() const
+//
+//  Get the number of active partitions, i.e. the size of the PartitionArray containers
+// ****************************************************************************************************
+
+Uint PartitionTable::GetNPartitions() const {
+    return Partitions.size();
+}
+
+// ****************************************************************************************************
+// *    Uint GetNRPCs() const
+//
+//  Get the number of RPCs of the infrastructure
+// ****************************************************************************************************
+
+Uint PartitionTable::GetNRPCs() const {
+    return RPCFirst.size()-1;
+}
+
+// ****************************************************************************************************
+// *    Uint GetFirst(Uint rpc) const
+//
+//  Get the index of the first partition of RPC rpc
+// ****************************************************************************************************
+
+Uint PartitionTable::GetFirst(Uint rpc) const {
+    return RPCFirst[rpc];
+}
+
+// ****************************************************************************************************
+// *    Uint GetLast(Uint rpc) const
+//
+//  Get the index following the last partition of RPC rpc
+// ****************************************************************************************************
+
+Uint PartitionTable::GetLast(Uint rpc) const {
+    return RPCFirst[rpc+1];
+}
+
+// ****************************************************************************************************
+// *    string GetRPCName(Uint rpc) const
+//
+//  Get the name of RPC rpc
+// ****************************************************************************************************
+
+string PartitionTable::GetRPCName(Uint rpc) const {
+    return RPCNames[rpc];
+}
+
+// ****************************************************************************************************
+// *    Uint FindFirst(Uint trolleyID, Uint slotID) const
+//
+//  Get the index of the first partition of the RPC placed in slot slotID of trolley trolleyID. Returns
+//  NOPARTITION if there is no such RPC in the infrastructure.
+// ****************************************************************************************************
+
+Uint PartitionTable::FindFirst(Uint trolleyID, Uint slotID) const {
+    if(trolleyID > 9 || slotID > 9) return NOPARTITION;
+    return SlotFirst[trolleyID*10+slotID];
+}
+
+// ****************************************************************************************************
+// *    const PartitionInfo& GetInfo(Uint index) const
+//
+//  Get the name and geometry of the partition with dense index index
+// ****************************************************************************************************
+
+const PartitionInfo& PartitionTable::GetInfo(Uint index) const {
+    return Partitions[index];
+}
@@ -0,0 +1,170 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    PeakFinder.cc
+// *
+// *    Class that defines PeakFinder objects. A finder gives
+// *    the gaussian parameters of the muon peak of a time
+// *    profile within a time range out of the weighted moments
+// *    of the bins. The Minuit fit of a gaussian is only used
+// *    when the estimate fails its quality check.
+//***************************************************************
+
+#include "TH1.h"
+#include "TF1.h"
+#include "TList.h"
+#include "TMath.h"
+
+#include "../include/PeakFinder.h"
+#include "../include/types.h"
+
+using namespace std;
+
+// ****************************************************************************************************
+// *    PeakFinder()
+//
+//  Default constructor. The gaussian is created once and reused for every fit.
+// ****************************************************************************************************
+
+PeakFinder::PeakFinder(){
+    Gauss = new TF1("slicefit","gaus(0)",TIMEREJECT,BMTDCWINDOW);
+}
+
+// ****************************************************************************************************
+// *    ~PeakFinder()
+//
+//  Destructor
+// ****************************************************************************************************
+
+PeakFinder::~PeakFinder(){
+    delete Gauss;
+}
+
+// ****************************************************************************************************
+// *    PeakParams GetDefault()
+//
+//  Returns the parameters a peak is given when there is no data to look for it.
+// ****************************************************************************************************
+
+PeakParams PeakFinder::GetDefault() const{
+    PeakParams peak;
+    peak.Height = 50.;
+    peak.Mean   = 300.;
+    peak.Sigma  = 10.;
+    peak.Fitted = false;
+
+    return peak;
+}
+
+// ****************************************************************************************************
+// *    bool Estimate(TH1* H, float low, float high, PeakParams& peak)
+//
+//  Estimates the gaussian parameters of the peak of H out of the mean and variance of the contents
+//  of the bins centered within [low,high]. The variance is corrected for the binning (Sheppard).
+//  Returns false if the estimate can't be trusted : not enough data, parameters out of their
+//  accepted ranges or a peak wider than +/-3 sigma within the range (the tails being cut, the
+//  spread would be underestimated).
+// ****************************************************************************************************
+
+bool PeakFinder::Estimate(TH1* H, float low, float high, PeakParams& peak) const{
+    int first = H->FindBin(low);
+    int last  = H->FindBin(high);
+
+    if(first < 1) first = 1;
+    if(last > H->GetNbinsX()) last = H->GetNbinsX();
+
+    Uint   nBins  = 0;
+    double SumW   = 0.;
+    double SumWX  = 0.;
+    double SumWX2 = 0.;
+
+    for(int b = first; b <= last; b++){
+        double x = H->GetBinCenter(b);
+        double w = H->GetBinContent(b);
+
+        if(x < low || x > high || w <= 0.) continue;
+
+        nBins++;
+        SumW   += w;
+        SumWX  += w*x;
+        SumWX2 += w*x*x;
+    }
+
+    if(nBins < PEAKMINBINS || SumW < PEAKMINHITS) return false;
+
+    double binWidth = H->GetBinWidth(first);
+    double mean     = SumWX/SumW;
+    double variance = SumWX2/SumW - mean*mean - binWidth*binWidth/12.;
+
+    if(variance <= 0.) return false;
+
+    double sigma  = TMath::Sqrt(variance);
+    double height = SumW*binWidth/(TMath::Sqrt(2.*TMath::Pi())*sigma);
+
+    bool IsInTime    = mean >= PEAKMINTIME && mean <= PEAKMAXTIME;
+    bool IsInSpread  = sigma >= PEAKMINSIGMA && sigma <= PEAKMAXSIGMA;
+    bool IsContained = 6.*sigma <= high-low;
+    bool IsInAmpl    = height >= PEAKMINAMPL && height <= PEAKMAXAMPL;
+
+    if(!IsInTime || !IsInSpread || !IsContained || !IsInAmpl) return false;
+
+    peak.Height = height;
+    peak.Mean   = mean;
+    peak.Sigma  = sigma;
+    peak.Fitted = false;
+
+    return true;
+}
+
+// ****************************************************************************************************
+// *    PeakParams Find(TH1* H, float low, float high)
+//
+//  Returns the gaussian parameters of the peak of H within [low,high]. When the estimate fails,
+//  the peak is fitted with a gaussian starting from the default parameters and the height of the
+//  highest bin. The fit is not stored into H.
+// ****************************************************************************************************
+
+PeakParams PeakFinder::Find(TH1* H, float low, float high){
+    PeakParams peak = GetDefault();
+
+    if(Estimate(H,low,high,peak)) return peak;
+
+    //Initialise with default parameters
+    //Amplitude
+    Gauss->SetParameter(0,(float)H->GetMaximum());
+    Gauss->SetParLimits(0,PEAKMINAMPL,PEAKMAXAMPL);
+    //Mean value
+    Gauss->SetParameter(1,peak.Mean);
+    Gauss->SetParLimits(1,PEAKMINTIME,PEAKMAXTIME);
+    //RMS
+    Gauss->SetParameter(2,peak.Sigma);
+    Gauss->SetParLimits(2,PEAKMINSIGMA,PEAKMAXSIGMA);
+
+    Gauss->SetRange(low,high);
+    H->Fit(Gauss,"QRN");
+
+    peak.Height = Gauss->GetParameter(0);
+    peak.Mean   = Gauss->GetParameter(1);
+    peak.Sigma  = Gauss->GetParameter(2);
+    peak.Fitted = true;
+
+    return peak;
+}
+
+// ****************************************************************************************************
+// *    void Draw(TH1* H, const PeakParams& peak, float low, float high)
+//
+//  Attaches to H the gaussian of parameters peak over [low,high] so that it is saved and drawn
+//  with the histogram. H owns the new function, a copy of the gaussian of the finder.
+// ****************************************************************************************************
+
+void PeakFinder::Draw(TH1* H, const PeakParams& peak, float low, float high) const{
+    TF1* curve = (TF1*)Gauss->Clone();
+    curve->SetRange(low,high);
+    curve->SetParameters(peak.Height,peak.Mean,peak.Sigma);
+
+    H->GetListOfFunctions()->Add(curve);
+}
@@ -59,10 +59,10 @@ RPC::RPC(string ID, IniFile* geofile){
     }
 
     stripGeo.clear();
-    string partID = "ABCD";
 
+    //The partitions are labelled A, B, C...
     for(Uint p = 0; p < GetNPartitions(); p++){
-        string areaID  = "ActiveArea-"  + CharToString(partID[p]);
+        string areaID  = "ActiveArea-"  + string(1,(char)('A'+p));
         stripGeo.push_back(geofile->floatType(ID,areaID,1.));
     }
 }
@@ -25,12 +25,14 @@
 
 #include "../include/RPCHit.h"
 #include "../include/Mapping.h"
+#include "../include/DecodeTable.h"
+#include "../include/PartitionTable.h"
+#include "../include/HitCache.h"
 #include "../include/types.h"
 #include "../include/utils.h"
-#include "../include/Infrastructure.h"
+#include "../include/PeakFinder.h"
 
 #include "TTree.h"
-#include "TF1.h"
 
 using namespace std;
 
@@ -45,212 +47,149 @@ RPCHit::RPCHit(){
 }
 
 // ****************************************************************************************************
-// *    RPCHit(int channel, float time, Infrastructure* Infra)
+// *    RPCHit(const ChannelCode& code, float time)
 //
-//  Constructor
+//  Constructor using the trolley, slot, partition and strip of the channel given by the decode table.
 // ****************************************************************************************************
 
-RPCHit::RPCHit(Uint channel, float time, Infrastructure* Infra){
-    Channel     = channel;              //RPC channel according to mapping (5 digits)
-    Trolley     = channel/10000;        //0, 1 or 3 (1st digit of the RPC channel)
-    Station     = (channel%10000)/1000; //From 1 to 4 (2nd digit)
-    Strip       = channel%1000;         //From 1 to 128 (3 last digits)
-
-    int nStripsPart = 0;
-    for(Uint tr = 0; tr < Infra->GetNTrolleys(); tr++){
-        if(Infra->GetTrolleyID(tr) == Trolley){
-            for(Uint sl = 0; sl < Infra->GetNSlots(tr); sl++){
-                if(Infra->GetSlotID(tr,sl) == Station)
-                    nStripsPart = Infra->GetNStrips(tr,sl);
-            }
-        }
-    }
-
-    Partition   = (Strip-1)/nStripsPart+1; //From 1 to 4
+RPCHit::RPCHit(const ChannelCode& code, float time){
+    Trolley     = code.Trolley;
+    Station     = code.Slot;
+    Strip       = code.Strip;
+    Partition   = code.Partition;
     TimeStamp   = time;
 }
 
 // ****************************************************************************************************
-// *    RPCHit(const RPCHit &other)
+// *    void BookBeamProfiles(GIFH1Array &tmpTimeProfile, Uint nPartitions)
 //
-//  Copy constructor
+//  Books the temporary time profiles used to look for the muon peak in every active partition.
 // ****************************************************************************************************
 
-RPCHit::RPCHit(const RPCHit &other){
-    Channel = other.Channel;
-    Trolley = other.Trolley;
-    Station = other.Station;
-    Strip = other.Strip;
-    Partition = other.Partition;
-    TimeStamp = other.TimeStamp;
+void BookBeamProfiles(GIFH1Array &tmpTimeProfile, Uint nPartitions){
+    tmpTimeProfile.rpc.assign(nPartitions,NULL);
+
+    for(Uint i = 0; i < nPartitions; i++){
+        string name = "tmpTProf" + intToString(i);
+        tmpTimeProfile.rpc[i] = new TH1F(name.c_str(),name.c_str(),BMTDCWINDOW/TIMEBIN,0.,BMTDCWINDOW);
+    }
 }
 
 // ****************************************************************************************************
-// *    ~RPCHit()
+// *    void FillBeamProfile(GIFH1Array &tmpTimeProfile, Uint channel, float timing,
+// *                         DecodeTable* Decoder)
 //
-//  Destructor
+//  Fills the temporary time profile of the partition TDC channel channel belongs to.
 // ****************************************************************************************************
 
-RPCHit::~RPCHit(){
+void FillBeamProfile(GIFH1Array &tmpTimeProfile, Uint channel, float timing,
+                     DecodeTable* Decoder){
+    //Get rid of the noise hits outside of the connected channels
+    if(channel > 5127) return;
+    const ChannelCode& code = Decoder->Decode(channel);
+    if(code.Partition == NOCHANNELLINK) return;
 
+    tmpTimeProfile.rpc[code.Index]->Fill(timing);
 }
 
 // ****************************************************************************************************
-// *    RPCHit& operator =(const RPCHit& other)
+// *    void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
+// *                        TTree* mytree, DecodeTable* Decoder, PartitionTable* Parts)
 //
-//  Copy operator
+//  Loops over all the data contained inside of the ROOT file and determines for each RPC the center
+//  of the muon peak and its spread. Then saves the result in 3 tables indexed like the partitions of
+//  the partition table.
 // ****************************************************************************************************
 
-RPCHit& RPCHit::operator =(const RPCHit& other){
-    if(this != &other){
-        Channel = other.Channel;
-        Trolley = other.Trolley;
-        Station = other.Station;
-        Strip = other.Strip;
-        Partition = other.Partition;
-        TimeStamp = other.TimeStamp;
-    }
-
-    return *this;
-}
+void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
+                    TTree* mytree, DecodeTable* Decoder, PartitionTable* Parts){
+    RAWData mydata;
 
-// ****************************************************************************************************
-// *    Uint GetChannel()
-//
-//  Get the private member Channel
-// ****************************************************************************************************
+    mydata.TDCCh = new vector<Uint>;
+    mydata.TDCTS = new vector<float>;
+    mydata.TDCCh->clear();
+    mydata.TDCTS->clear();
 
-Uint RPCHit::GetChannel(){
-    return Channel;
-}
+    mytree->SetBranchAddress("TDC_channel",    &mydata.TDCCh);
+    mytree->SetBranchAddress("TDC_TimeStamp",  &mydata.TDCTS);
 
-// ****************************************************************************************************
-// *    Uint GetTrolley()
-//
-//  Get the private member Trolley
-// ****************************************************************************************************
+    GIFH1Array tmpTimeProfile;
+    BookBeamProfiles(tmpTimeProfile,Decoder->GetNPartitions());
 
-Uint RPCHit::GetTrolley(){
-    return Trolley;
-}
+    //Loop over the entries to get the hits and fill the time distribution + count the
+    //noise hits in the window around the peak
 
-// ****************************************************************************************************
-// *    Uint GetStation()
-//
-//  Get the private member Station
-// ****************************************************************************************************
+    for(Uint i = 0; i < mytree->GetEntries(); i++){
+        mytree->GetEntry(i);
 
-Uint RPCHit::GetStation(){
-    return Station;
-}
+        for(Uint h = 0; h < mydata.TDCCh->size(); h++)
+            FillBeamProfile(tmpTimeProfile, mydata.TDCCh->at(h), mydata.TDCTS->at(h), Decoder);
+    }
 
-// ****************************************************************************************************
-// *    Uint GetStrip()
-//
-//  Get the private member Strip
-// ****************************************************************************************************
+    mytree->ResetBranchAddresses();
+    delete mydata.TDCCh;
+    delete mydata.TDCTS;
 
-Uint RPCHit::GetStrip(){
-    return Strip;
+    FitBeamWindow(PeakHeight,PeakTime,PeakWidth,tmpTimeProfile,Parts);
+    DeleteHistos(tmpTimeProfile);
 }
 
 // ****************************************************************************************************
-// *    Uint GetPartition()
+// *    void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
+// *                        RAWDataBuffer &buffer, DecodeTable* Decoder, PartitionTable* Parts)
 //
-//  Get the private member Partition
+//  Same as above but using the content of the ROOT file previously loaded into memory with
+//  ReadRAWData(...). This way, the file doesn't need to be read a second time for the analysis.
 // ****************************************************************************************************
 
-Uint RPCHit::GetPartition(){
-    return Partition;
-}
+void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
+                    RAWDataBuffer &buffer, DecodeTable* Decoder, PartitionTable* Parts){
+    GIFH1Array tmpTimeProfile;
+    BookBeamProfiles(tmpTimeProfile,Decoder->GetNPartitions());
 
-// ****************************************************************************************************
-// *    Uint GetTime()
-//
-//  Get the private member TimeStamp
-// ****************************************************************************************************
+    for(Uint h = 0; h < buffer.TDCCh.size(); h++)
+        FillBeamProfile(tmpTimeProfile, buffer.TDCCh[h], buffer.TDCTS[h], Decoder);
 
-float RPCHit::GetTime(){
-    return TimeStamp;
+    FitBeamWindow(PeakHeight,PeakTime,PeakWidth,tmpTimeProfile,Parts);
+    DeleteHistos(tmpTimeProfile);
 }
 
 // ****************************************************************************************************
-// *    bool SortHitbyStrip(RPCHit h1, RPCHit h2)
+// *    void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
+// *                        HitCache &cache, PartitionTable* Parts)
 //
-//  Sort RPC hits using strip position information
+//  Same as above but using the hits of the compact hit cache of the DAQ file. The hits are already
+//  decoded and only the ones flagged as not used for the muon peak search are skipped.
 // ****************************************************************************************************
 
-bool SortHitbyStrip(RPCHit h1, RPCHit h2){
-    return (h1.GetStrip() < h2.GetStrip());
-}
+void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
+                    HitCache &cache, PartitionTable* Parts){
+    GIFH1Array tmpTimeProfile;
+    BookBeamProfiles(tmpTimeProfile,Parts->GetNPartitions());
 
-// ****************************************************************************************************
-// *    bool SortHitbyTime(RPCHit h1, RPCHit h2)
-//
-//  Sort RPC hits using time stamp information
-// ****************************************************************************************************
+    for(Uint h = 0; h < cache.GetNHits(); h++)
+        if(cache.IsBeamHit(h))
+            tmpTimeProfile.rpc[cache.GetIndex(h)]->Fill(cache.GetTime(h));
 
-//Sort hits by time
-bool SortHitbyTime(RPCHit h1, RPCHit h2){
-    return (h1.GetTime() < h2.GetTime());
+    FitBeamWindow(PeakHeight,PeakTime,PeakWidth,tmpTimeProfile,Parts);
+    DeleteHistos(tmpTimeProfile);
 }
 
 // ****************************************************************************************************
-// *    void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
-// *                        TTree* mytree, Mapping* RPCChMap, Infrastructure* Infra)
+// *    void FitBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
+// *                        GIFH1Array &tmpTimeProfile, PartitionTable* Parts)
 //
-//  Loops over all the data contained inside of the ROOT file and determines for each RPC the center
-//  of the muon peak and its spread. Then saves the result in 2 3D tables (#D bescause it follows the
-//  dimensions of the GIF++ infrastructure : Trolley, RPC slots and Partitions).
+//  Fits the muon peak of the temporary time profiles filled by SetBeamWindow(...) and saves its
+//  height, center and spread for each partition. The fits always use the minimizer of the parallel
+//  fits so that the beam window doesn't depend on the number of HV steps analysed at once.
 // ****************************************************************************************************
 
-void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
-                    TTree* mytree, Mapping* RPCChMap, Infrastructure* Infra){
-    RAWData mydata;
-
-    mydata.TDCCh = new vector<Uint>;
-    mydata.TDCTS = new vector<float>;
-    mydata.TDCCh->clear();
-    mydata.TDCTS->clear();
-
-    mytree->SetBranchAddress("EventNumber",    &mydata.iEvent);
-    mytree->SetBranchAddress("number_of_hits", &mydata.TDCNHits);
-    mytree->SetBranchAddress("TDC_channel",    &mydata.TDCCh);
-    mytree->SetBranchAddress("TDC_TimeStamp",  &mydata.TDCTS);
-
-    GIFH1Array tmpTimeProfile;
-    GIFfloatArray noiseHits = {{{0.}}};
+void FitBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidth,
+                    GIFH1Array &tmpTimeProfile, PartitionTable* Parts){
+    Uint nPartitions = Parts->GetNPartitions();
+    GIFfloatArray noiseHits(nPartitions,0.);
     int binWidth = TIMEBIN;
 
-    for(Uint tr = 0; tr < NTROLLEYS; tr++)
-        for(Uint sl = 0; sl < NSLOTS; sl++)
-            for(Uint p = 0; p < NPARTITIONS; p++){
-                string name = "tmpTProf" + intToString(tr) + intToString(sl) +  intToString(p);
-                tmpTimeProfile.rpc[tr][sl][p] = new TH1F(name.c_str(),name.c_str(),BMTDCWINDOW/TIMEBIN,0.,BMTDCWINDOW);
-            }
-
-    //Loop over the entries to get the hits and fill the time distribution + count the
-    //noise hits in the window around the peak
-
-    for(Uint i = 0; i < mytree->GetEntries(); i++){
-        mytree->GetEntry(i);
-
-        for(int h = 0; h < mydata.TDCNHits; h++){
-            Uint channel = mydata.TDCCh->at(h);
-            float timing = mydata.TDCTS->at(h);
-
-            //Get rid of the noise hits outside of the connected channels
-            if(channel > 5127) continue;
-            if(RPCChMap->GetLink(channel) == 0) continue;
-            RPCHit tmpHit(RPCChMap->GetLink(channel), timing, Infra);
-            Uint T = tmpHit.GetTrolley();
-            Uint S = tmpHit.GetStation()-1;
-            Uint P = tmpHit.GetPartition()-1;
-
-            tmpTimeProfile.rpc[T][S][P]->Fill(tmpHit.GetTime());
-        }
-    }
-
     //Compute the average number of noise hits per 10ns bin and subtract it to the time
     //distribution in order to have a better fit on the muon peak (noise removal). Also,
     //as this information is not available directly, try to evaluate which one of the
@@ -258,108 +197,100 @@ void SetBeamWindow (muonPeak &PeakHeight, muonPeak &PeakTime, muonPeak &PeakWidt
     //partitions. For this measure which partition has the highest bin. Indeed, the
     //partition illuminated by the beam is likely to have the highest content of data.
     //Keep track of all the value thanks to a float array.
-    muonPeak center;
-    muonPeak lowlimit;
-    muonPeak highlimit;
-
-    for(Uint tr = 0; tr < NTROLLEYS; tr++){
-        for(Uint sl = 0; sl < NSLOTS; sl++){
-            for(Uint p = 0; p < NPARTITIONS; p++){
-                //Fit with a gaussian the "Good TDC Time"
-                TF1 *slicefit = new TF1("slicefit","gaus(0)",TIMEREJECT,BMTDCWINDOW);
-
-                //Initialise with default parameters
-                //Amplitude
-                slicefit->SetParameter(0,50);
-                slicefit->SetParLimits(0,1,100000);
-                //Mean value
-                slicefit->SetParameter(1,300);
-                slicefit->SetParLimits(1,200,400);
-                //RMS
-                slicefit->SetParameter(2,10);
-                slicefit->SetParLimits(2,1,40);
-
-                //Work only with the filled histograms.
-                //Find the highest bin. Assume than the beam peak is within
-                //a range of 80ns around the max bin. Evaluate the level of
-                //noise outside of this range and subtract it from each bin.
-                //Then finally fir and extract fit parameters.
-                if(tmpTimeProfile.rpc[tr][sl][p]->GetEntries() > 0.){
-                    center.rpc[tr][sl][p] = (float)tmpTimeProfile.rpc[tr][sl][p]->GetMaximumBin()*TIMEBIN;
-                    lowlimit.rpc[tr][sl][p] = center.rpc[tr][sl][p] - 40.;
-                    highlimit.rpc[tr][sl][p] = center.rpc[tr][sl][p] + 40.;
-
-                    float timeWdw = BMTDCWINDOW-TIMEREJECT-(highlimit.rpc[tr][sl][p]-lowlimit.rpc[tr][sl][p]);
-
-                    int nNoiseHitsLow =
-                            tmpTimeProfile.rpc[tr][sl][p]->Integral(TIMEREJECT/TIMEBIN,lowlimit.rpc[tr][sl][p]/TIMEBIN);
-                    int nNoiseHitsHigh =
-                            tmpTimeProfile.rpc[tr][sl][p]->Integral(highlimit.rpc[tr][sl][p]/TIMEBIN,BMTDCWINDOW/TIMEBIN);
-
-                    noiseHits.rpc[tr][sl][p] = (float)binWidth*(nNoiseHitsLow+nNoiseHitsHigh)/timeWdw;
-
-                    for(Uint b = 1; b <= BMTDCWINDOW/binWidth; b++){
-                        float binContent = (float)tmpTimeProfile.rpc[tr][sl][p]->GetBinContent(b);
-                        float correctedContent = (binContent < noiseHits.rpc[tr][sl][p])
-                                ? 0.
-                                : binContent-noiseHits.rpc[tr][sl][p];
-                        tmpTimeProfile.rpc[tr][sl][p]->SetBinContent(b,correctedContent);
-                    }
-
-                    //Reset the fit function range with position of max bin
-                    slicefit->SetRange(lowlimit.rpc[tr][sl][p],highlimit.rpc[tr][sl][p]);
-
-                    //Reset amplitude with amplitude of highest bin
-                    slicefit->SetParameter(0,(float)tmpTimeProfile.rpc[tr][sl][p]->GetMaximum());
-
-                    //Fit the peak time
-                    tmpTimeProfile.rpc[tr][sl][p]->Fit(slicefit,"QR");
-
-                    //Save the max value of the histogram
-                    PeakHeight.rpc[tr][sl][p] = tmpTimeProfile.rpc[tr][sl][p]->GetMaximum();
-                }
+    muonPeak center(nPartitions,0.);
+    muonPeak lowlimit(nPartitions,0.);
+    muonPeak highlimit(nPartitions,0.);
+
+    string minimizer, algorithm;
+    EnableParallelFits(minimizer,algorithm);
+
+    PeakFinder Finder;
+
+    for(Uint i = 0; i < nPartitions; i++){
+        //Partition inside of the RPC. The partitions of an RPC
+        //follow each other in the dense index.
+        Uint p = Parts->GetInfo(i).Partition;
+
+        //Gaussian parameters of the "Good TDC Time" peak, the
+        //default ones being kept for empty histograms
+        PeakParams peak = Finder.GetDefault();
+
+        //Work only with the filled histograms.
+        //Find the highest bin. Assume than the beam peak is within
+        //a range of 80ns around the max bin. Evaluate the level of
+        //noise outside of this range and subtract it from each bin.
+        //Then finally look for the peak and extract its parameters.
+        if(tmpTimeProfile.rpc[i]->GetEntries() > 0.){
+            center.rpc[i] = (float)tmpTimeProfile.rpc[i]->GetMaximumBin()*TIMEBIN;
+            lowlimit.rpc[i] = center.rpc[i] - 40.;
+            highlimit.rpc[i] = center.rpc[i] + 40.;
+
+            float timeWdw = BMTDCWINDOW-TIMEREJECT-(highlimit.rpc[i]-lowlimit.rpc[i]);
+
+            int nNoiseHitsLow =
+                    tmpTimeProfile.rpc[i]->Integral(TIMEREJECT/TIMEBIN,lowlimit.rpc[i]/TIMEBIN);
+            int nNoiseHitsHigh =
+                    tmpTimeProfile.rpc[i]->Integral(highlimit.rpc[i]/TIMEBIN,BMTDCWINDOW/TIMEBIN);
+
+            noiseHits.rpc[i] = (float)binWidth*(nNoiseHitsLow+nNoiseHitsHigh)/timeWdw;
+
+            for(Uint b = 1; b <= BMTDCWINDOW/binWidth; b++){
+                float binContent = (float)tmpTimeProfile.rpc[i]->GetBinContent(b);
+                float correctedContent = (binContent < noiseHits.rpc[i])
+                        ? 0.
+                        : binContent-noiseHits.rpc[i];
+                tmpTimeProfile.rpc[i]->SetBinContent(b,correctedContent);
+            }
 
-                //Check whether this partition is more likely to be the illuminated one.
-                //If it is, apply to the other partition-s previously checked the same
-                //peak settings. Otherwise get the same settings for this partition than
-                //for the previous one.
-                //As a second check, make sure the peak is small enough. It should not
-                //exceed 60ns. It it is higher, there is a strong chance the fit didn't
-                //work, because of too low statistics. Then use the settings of the previous
-                //partition if it not the first partition. If it is the first partition
-                //checked, then use default parameters (peak = 300ns and width = 60ns)
-                //and set the peak height to 0.
-                //Finally, the peak should be in between 200 and 450ns of within the time
-                //distribution (there are no detectors outside of this window so far).
-                //Control this as well and use default values if the peak is outside.
-                bool IsNarrow = 3.*slicefit->GetParameter(2) <= 60;
-                bool IsInTime = slicefit->GetParameter(1) >= 200 && slicefit->GetParameter(1) <= 450;
-
-                if(p > 0){
-                    bool IsHighestPeak= PeakHeight.rpc[tr][sl][p] > PeakHeight.rpc[tr][sl][p-1];
-
-                    if(IsHighestPeak && IsNarrow && IsInTime){
-                        for(Uint part = 0; part <= p; part++){
-                            PeakTime.rpc[tr][sl][part] = slicefit->GetParameter(1);
-                            PeakWidth.rpc[tr][sl][part] = 3.*slicefit->GetParameter(2);
-                            PeakHeight.rpc[tr][sl][part] = PeakHeight.rpc[tr][sl][p];
-                        }
-                    } else {
-                        PeakTime.rpc[tr][sl][p] = PeakTime.rpc[tr][sl][p-1];
-                        PeakWidth.rpc[tr][sl][p] = PeakWidth.rpc[tr][sl][p-1];
-                        PeakHeight.rpc[tr][sl][p] = PeakHeight.rpc[tr][sl][p-1];
-                    }
-                } else {
-                    if(IsNarrow && IsInTime){
-                            PeakTime.rpc[tr][sl][p] = slicefit->GetParameter(1);
-                            PeakWidth.rpc[tr][sl][p] = 3.*slicefit->GetParameter(2);
-                    } else {
-                        PeakTime.rpc[tr][sl][p] = 300;
-                        PeakWidth.rpc[tr][sl][p] = 60;
-                        PeakHeight.rpc[tr][sl][p] = 0.;
-                    }
+            //Estimate the peak within the range around the max bin
+            //(fit only if the estimate fails)
+            peak = Finder.Find(tmpTimeProfile.rpc[i],lowlimit.rpc[i],highlimit.rpc[i]);
+
+            //Save the max value of the histogram
+            PeakHeight.rpc[i] = tmpTimeProfile.rpc[i]->GetMaximum();
+        }
+
+        //Check whether this partition is more likely to be the illuminated one.
+        //If it is, apply to the other partition-s previously checked the same
+        //peak settings. Otherwise get the same settings for this partition than
+        //for the previous one.
+        //As a second check, make sure the peak is small enough. It should not
+        //exceed 60ns. It it is higher, there is a strong chance the fit didn't
+        //work, because of too low statistics. Then use the settings of the previous
+        //partition if it not the first partition. If it is the first partition
+        //checked, then use default parameters (peak = 300ns and width = 60ns)
+        //and set the peak height to 0.
+        //Finally, the peak should be in between 200 and 450ns of within the time
+        //distribution (there are no detectors outside of this window so far).
+        //Control this as well and use default values if the peak is outside.
+        bool IsNarrow = 3.*peak.Sigma <= 60;
+        bool IsInTime = peak.Mean >= 200 && peak.Mean <= 450;
+
+        if(p > 0){
+            bool IsHighestPeak= PeakHeight.rpc[i] > PeakHeight.rpc[i-1];
+
+            if(IsHighestPeak && IsNarrow && IsInTime){
+                for(Uint part = 0; part <= p; part++){
+                    PeakTime.rpc[i-p+part] = peak.Mean;
+                    PeakWidth.rpc[i-p+part] = 3.*peak.Sigma;
+                    PeakHeight.rpc[i-p+part] = PeakHeight.rpc[i];
                 }
+            } else {
+                PeakTime.rpc[i] = PeakTime.rpc[i-1];
+                PeakWidth.rpc[i] = PeakWidth.rpc[i-1];
+                PeakHeight.rpc[i] = PeakHeight.rpc[i-1];
+            }
+        } else {
+            if(IsNarrow && IsInTime){
+                    PeakTime.rpc[i] = peak.Mean;
+                    PeakWidth.rpc[i] = 3.*peak.Sigma;
+            } else {
+                PeakTime.rpc[i] = 300;
+                PeakWidth.rpc[i] = 60;
+                PeakHeight.rpc[i] = 0.;
             }
         }
     }
+
+    RestoreMinimizer(minimizer,algorithm);
 }
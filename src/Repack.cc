@@ -0,0 +1,206 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    Repack.cc
+// *
+// *    Rewriting of the DAQ files for the analysis : only the
+// *    branches read by the analysis, the event number and the
+// *    number of hits are kept, with larger baskets and
+// *    clusters and a faster compression codec.
+// *    The repacked file has the same content for the analysis
+// *    and can replace the DAQ file. The read throughput of
+// *    both files is reported.
+//***************************************************************
+
+#include <string>
+#include <set>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TStopwatch.h"
+
+#include "../include/Repack.h"
+#include "../include/MsgSvc.h"
+#include "../include/types.h"
+#include "../include/utils.h"
+
+using namespace std;
+
+// ****************************************************************************************************
+// *    int GetCompression(string codec)
+//
+//  Returns the ROOT compression settings of the codec lz4, zstd or zlib. Any other name gives the
+//  default, lz4, that decompresses the fastest.
+// ****************************************************************************************************
+
+int GetCompression(string codec){
+    if(codec == "zstd") return PACKZSTD;
+    else if(codec == "zlib") return PACKZLIB;
+    else {
+        if(codec != "lz4") MSG_WARNING("[Repack] Unknown codec " + codec + ", lz4 used instead");
+        return PACKLZ4;
+    }
+}
+
+// ****************************************************************************************************
+// *    double MeasureReading(string fileName, double& megabytes)
+//
+//  Reads all the entries of the RAWData tree of fileName the way the analysis does (same branches)
+//  and returns the time it took in seconds. megabytes is set to the amount of data read from the
+//  file. Returns 0 if the file couldn't be read.
+// ****************************************************************************************************
+
+double MeasureReading(string fileName, double& megabytes){
+    megabytes = 0.;
+
+    TFile file(fileName.c_str());
+    if(!file.IsOpen()) return 0.;
+
+    TTree* tree = (TTree*)file.Get("RAWData");
+    if(tree == NULL) return 0.;
+
+    bool isNewFormat = tree->GetListOfBranches()->Contains("Quality_flag");
+    Uint nEntries = tree->GetEntries();
+
+    SetTreeReading(tree,isNewFormat,0,nEntries,0);
+
+    RAWData data;
+
+    data.QFlag = GOOD;
+    data.TDCCh = new vector<Uint>;
+    data.TDCTS = new vector<float>;
+
+    tree->SetBranchAddress("TDC_channel",    &data.TDCCh);
+    tree->SetBranchAddress("TDC_TimeStamp",  &data.TDCTS);
+
+    if(isNewFormat)
+        tree->SetBranchAddress("Quality_flag", &data.QFlag);
+
+    TStopwatch timer;
+    timer.Start();
+
+    for(Uint i = 0; i < nEntries; i++)
+        tree->GetEntry(i);
+
+    timer.Stop();
+
+    tree->ResetBranchAddresses();
+    delete data.TDCCh;
+    delete data.TDCTS;
+
+    megabytes = file.GetBytesRead()/1e6;
+    file.Close();
+
+    return timer.RealTime();
+}
+
+// ****************************************************************************************************
+// *    void RepackDAQFile(string baseName, RepackOptions& options)
+//
+//  Rewrites baseName_DAQ.root into baseName_DAQ-Repacked.root. The RAWData tree only keeps the
+//  branches read by the analysis, EventNumber and number_of_hits and is written with the basket
+//  size, cluster size and compression of the options. All the other objects of the file
+//  (RunParameters tree, histograms, ...) are copied as they are. The original file is left
+//  untouched : once the repacked one is checked, it can be renamed into baseName_DAQ.root and
+//  analysed as usual. Finally, the time needed to read both files is compared.
+// ****************************************************************************************************
+
+void RepackDAQFile(string baseName, RepackOptions& options){
+    string daqName = baseName + "_DAQ.root";
+    string packName = baseName + __repacked;
+
+    TFile inFile(daqName.c_str());
+
+    if(!inFile.IsOpen()){
+        MSG_ERROR("[Repack] File " + daqName + " could not be opened");
+        return;
+    }
+
+    TTree* inTree = (TTree*)inFile.Get("RAWData");
+
+    if(inTree == NULL){
+        MSG_ERROR("[Repack] No RAWData tree in " + daqName);
+        inFile.Close();
+        return;
+    }
+
+    bool isNewFormat = inTree->GetListOfBranches()->Contains("Quality_flag");
+    Uint nEntries = inTree->GetEntries();
+
+    //Only the active branches are cloned : the ones of the analysis
+    //and the event number and hit count the other tools still read
+    SetTreeReading(inTree,isNewFormat,0,nEntries,0);
+    inTree->SetBranchStatus("EventNumber",true);
+    inTree->SetBranchStatus("number_of_hits",true);
+
+    TFile outFile(packName.c_str(),"RECREATE","",options.Compression);
+
+    if(!outFile.IsOpen()){
+        MSG_ERROR("[Repack] File " + packName + " could not be created");
+        inFile.Close();
+        return;
+    }
+
+    MSG_INFO("[Repack] Repacking " + daqName + " into " + packName);
+
+    TTree* outTree = inTree->CloneTree(0);
+    outTree->SetBasketSize("*",options.BasketKB*1024);
+    outTree->SetAutoFlush(-(Long64_t)options.ClusterMB*1000000);
+
+    for(Uint i = 0; i < nEntries; i++){
+        inTree->GetEntry(i);
+        outTree->Fill();
+    }
+
+    outFile.cd();
+    outTree->Write();
+
+    //Copy the other objects, only keeping the last cycle of each
+    set<string> copied;
+    copied.insert("RAWData");
+
+    TIter nextKey(inFile.GetListOfKeys());
+    TKey* key;
+
+    while((key = (TKey*)nextKey()) != NULL){
+        string name = key->GetName();
+        if(copied.count(name) > 0) continue;
+        copied.insert(name);
+
+        TObject* object = inFile.Get(name.c_str());
+        if(object == NULL) continue;
+
+        outFile.cd();
+
+        if(object->InheritsFrom("TTree")){
+            TTree* copy = ((TTree*)object)->CloneTree(-1);
+            copy->Write();
+        } else
+            outFile.WriteTObject(object,name.c_str());
+    }
+
+    outFile.Close();
+    inFile.Close();
+
+    //Compare the read throughput of both files. Both of them were just
+    //read or written, so both are measured after the repacking.
+    double daqMB, packMB;
+    double daqTime = MeasureReading(daqName,daqMB);
+    double packTime = MeasureReading(packName,packMB);
+
+    MSG_INFO("[Repack] " + intToString(nEntries) + " entries");
+    MSG_INFO("[Repack] " + daqName + " : " + floatTostring(daqMB) + " MB read in "
+             + floatTostring(daqTime) + " s ("
+             + floatTostring((daqTime > 0) ? nEntries/daqTime : 0) + " entries/s)");
+    MSG_INFO("[Repack] " + packName + " : " + floatTostring(packMB) + " MB read in "
+             + floatTostring(packTime) + " s ("
+             + floatTostring((packTime > 0) ? nEntries/packTime : 0) + " entries/s)");
+
+    if(packTime > 0)
+        MSG_INFO("[Repack] Read speed-up : " + floatTostring(daqTime/packTime));
+}
@@ -0,0 +1,206 @@
+//***************************************************************
+// *    GIF OFFLINE TOOL v7
+// *
+// *    Program developped to extract from the raw data files
+// *    the rates, currents and DIP parameters.
+// *
+// *    ScanAnalysis.cc
+// *
+// *    Analysis of all the HV steps of a scan directory in a
+// *    single process. The geometry, mapping and decoding
+// *    tables are built once for the whole scan and several
+// *    HV steps are analysed at once. The CSV files of the
+// *    scan are still written following the order of the HV
+// *    steps.
+//***************************************************************
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <dirent.h>
+
+#include "TH1.h"
+#include "TROOT.h"
+
+#include "../include/ScanAnalysis.h"
+#include "../include/OfflineAnalysis.h"
+#include "../include/Current.h"
+#include "../include/MsgSvc.h"
+#include "../include/types.h"
+#include "../include/utils.h"
+
+using namespace std;
+
+// ****************************************************************************************************
+// *    bool SortStepsByHV(const ScanStep& s1, const ScanStep& s2)
+//
+//  Sort the HV steps using their number
+// ****************************************************************************************************
+
+bool SortStepsByHV(const ScanStep& s1, const ScanStep& s2){
+    if(s1.HVstep != s2.HVstep) return (s1.HVstep < s2.HVstep);
+    else return (s1.BaseName < s2.BaseName);
+}
+
+// ****************************************************************************************************
+// *    void FindScanSteps(string scanDir, vector<ScanStep>& Steps)
+//
+//  Lists the HV steps of the scan directory scanDir out of the names of its Scan00XXXX_HVn_DAQ.root
+//  and Scan00XXXX_HVn_CAEN.root files. The steps are sorted by HV step number.
+// ****************************************************************************************************
+
+void FindScanSteps(string scanDir, vector<ScanStep>& Steps){
+    Steps.clear();
+
+    DIR* directory = opendir(scanDir.c_str());
+    if(directory == NULL) return;
+
+    const string suffixes[2] = {"_DAQ.root", "_CAEN.root"};
+    map<string,ScanStep> Found;
+    struct dirent* entry;
+
+    while((entry = readdir(directory)) != NULL){
+        string name = entry->d_name;
+
+        for(Uint f = 0; f < 2; f++){
+            const string& suffix = suffixes[f];
+            if(name.size() <= suffix.size()) continue;
+            if(name.compare(name.size()-suffix.size(),suffix.size(),suffix) != 0) continue;
+
+            //The HV step number follows the last _HV of the name
+            string prefix = name.substr(0,name.size()-suffix.size());
+            size_t hv = prefix.rfind("_HV");
+            if(hv == string::npos || hv+3 == prefix.size()) continue;
+
+            string number = prefix.substr(hv+3);
+            if(number.find_first_not_of("0123456789") != string::npos) continue;
+
+            if(Found.count(prefix) == 0){
+                ScanStep step = {(Uint)atoi(number.c_str()), scanDir + "/" + prefix, false, false};
+                Found[prefix] = step;
+            }
+
+            ScanStep& step = Found[prefix];
+            if(f == 0) step.HasDAQ = true;
+            else step.HasCAEN = true;
+        }
+    }
+
+    closedir(directory);
+
+    for(map<string,ScanStep>::iterator it = Found.begin(); it != Found.end(); it++)
+        Steps.push_back(it->second);
+
+    sort(Steps.begin(),Steps.end(),SortStepsByHV);
+}
+
+// ****************************************************************************************************
+// *    void ScanAnalysis(string scanDir, AnalysisOptions& options, Uint nSteps)
+//
+//  Analyses all the HV steps of the scan directory scanDir with the same geometry, mapping and
+//  decoding tables. nSteps threads pick the HV steps one after the other and, when a thread starts
+//  a step, the DAQ file of the next step starts being read in the background. The CSV rows of a step
+//  (offline analysis and currents) are written as soon as all the previous steps are written so that
+//  the CSV files follow the order of the HV steps.
+// ****************************************************************************************************
+
+void ScanAnalysis(string scanDir, AnalysisOptions& options, Uint nSteps){
+    vector<ScanStep> Steps;
+    FindScanSteps(scanDir,Steps);
+
+    if(Steps.empty()){
+        MSG_ERROR("[Offline] No DAQ or CAEN file in " + scanDir);
+        return;
+    }
+
+    //Write in the files of the RUN directory the path to the scan
+    //directory to know where to write the logs
+    WritePath(Steps[0].BaseName);
+
+    Uint nHVSteps = Steps.size();
+    if(nSteps > nHVSteps) nSteps = nHVSteps;
+    if(nSteps < 1) nSteps = 1;
+
+    MSG_INFO("[Offline] " + intToString(nHVSteps) + " HV steps found in " + scanDir);
+
+    //The histograms are kept out of ROOT's directories during the
+    //whole scan (see OfflineAnalysis(...))
+    bool addDirectory = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(false);
+
+    AnalysisSetup setup;
+    LoadSetup(scanDir,setup);
+
+    //The HV steps analysed at once use ROOT at the same time. Their
+    //fits select the parallel minimizer by themselves, as for the
+    //analysis of a single HV step, so the results are the same
+    if(nSteps > 1){
+        MSG_INFO("[Offline] " + intToString(nSteps) + " HV steps analysed at once");
+        ROOT::EnableThreadSafety();
+    }
+
+    vector<AnalysisOutput> Outputs(nHVSteps);
+    vector<bool> Done(nHVSteps,false);
+    vector<bool> Analysed(nHVSteps,false);
+    Uint nWritten = 0;
+
+    mutex OutputMutex;
+    atomic<Uint> next(0);
+
+    auto RunSteps = [&](){
+        for(Uint s = next++; s < nHVSteps; s = next++){
+            //Start reading the DAQ files of the next HV step while
+            //this one is analysed
+            if(s+1 < nHVSteps && Steps[s+1].HasDAQ){
+                vector<string> NextFiles;
+                FindDAQFiles(Steps[s+1].BaseName,NextFiles);
+
+                for(Uint f = 0; f < NextFiles.size(); f++)
+                    PrefetchFile(NextFiles[f]);
+            }
+
+            bool analysed = false;
+
+            if(Steps[s].HasDAQ)
+                analysed = AnalyseStep(Steps[s].BaseName,options,setup,Outputs[s]);
+            else
+                MSG_ERROR("[Offline] No DAQ file for run " + Steps[s].BaseName);
+
+            lock_guard<mutex> lock(OutputMutex);
+            Done[s] = true;
+            Analysed[s] = analysed;
+
+            //Write the steps that are done and only follow written steps
+            for(; nWritten < nHVSteps && Done[nWritten]; nWritten++){
+                const ScanStep& step = Steps[nWritten];
+
+                if(Analysed[nWritten]) WriteOutput(scanDir,Outputs[nWritten]);
+                Outputs[nWritten] = AnalysisOutput();
+
+                if(step.HasCAEN) GetCurrent(step.BaseName,setup.GIFInfra);
+                else MSG_ERROR("[Offline] No CAEN file for run " + step.BaseName);
+            }
+        }
+    };
+
+    if(nSteps <= 1)
+        RunSteps();
+    else {
+        vector<thread> Workers;
+
+        for(Uint w = 0; w < nSteps; w++)
+            Workers.push_back(thread(RunSteps));
+
+        for(Uint w = 0; w < nSteps; w++)
+            Workers[w].join();
+    }
+
+    DeleteSetup(setup);
+
+    TH1::AddDirectory(addDirectory);
+}
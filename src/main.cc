@@ -12,9 +12,15 @@
 
 #include <sstream>
 #include <string>
+#include <cstdlib>
+#include <algorithm>
 
 #include "../include/OfflineAnalysis.h"
 #include "../include/Current.h"
+#include "../include/Repack.h"
+#include "../include/ScanAnalysis.h"
+#include "../include/PartialResults.h"
+#include "../include/FollowAnalysis.h"
 #include "../include/MsgSvc.h"
 #include "../include/utils.h"
 
@@ -27,23 +33,179 @@ int main(int argc ,char *argv[]){
     converter >> program;
     converter.clear();
 
-    if(argc != 2){
-        MSG_WARNING("[Offline] expects to have 2 parameters");
-        MSG_WARNING("[Offline] USAGE is : " + program + " filebasename");
+    //Read the options given along with the file base name
+    //-j or --threads N : number of threads used by the loop over
+    //the DAQ file entries (1 by default)
+    //--single-pass : keep the content of the DAQ file in memory after
+    //the muon peak search instead of reading it a second time for the
+    //analysis (efficiency runs only, needs memory for the whole run)
+    //--pipeline : read the DAQ file on a thread of its own, ahead of
+    //the nThreads analysis threads
+    //--prefetch N : number of chunks of entries read ahead for each
+    //analysis thread in pipeline mode (8 by default)
+    //--cache MB : size of the TTreeCache used to read the DAQ file
+    //(ROOT default by default)
+    //--hit-cache : convert the DAQ file into a compact hit cache next
+    //to it, if there is no up to date one, to analyse it faster the
+    //next times (an up to date cache is always used)
+    //--repack : instead of the analysis, rewrite the DAQ file into
+    //filebasename_DAQ-Repacked.root with only the analysis branches,
+    //the event number and the number of hits and compare the read
+    //throughput of both files
+    //--codec lz4|zstd|zlib : compression of the repacked file (lz4)
+    //--basket kB : basket size of the repacked file (512 kB)
+    //--cluster MB : cluster size of the repacked file (32 MB)
+    //--scan dir : instead of a file base name, analyse all the HV
+    //steps of the scan directory dir in this process
+    //--steps N : number of HV steps analysed at once in scan mode (2)
+    //--entries first:last : only loop over the entries [first,last[
+    //of the DAQ file and save the raw results into
+    //filebasename_Partial-first-last.raw (last can be left empty to
+    //go to the end of the file)
+    //--peak : only search the muon peak of the DAQ file and save it
+    //into filebasename_Peak.raw for the --entries processes to share
+    //--merge : instead of the loop, merge the partial files of the DAQ
+    //file and run the rest of the analysis once on the merged results
+    //--checkpoint s : save the state of the loop over the entries
+    //every s seconds to resume it if the analysis is stopped (no
+    //checkpoint by default)
+    //--follow s : analyse the DAQ file while it is being written and
+    //publish a snapshot of the results every s seconds
+    //--idle s : in follow mode, time without new entries after which
+    //the run is over and the final results are written (600 s)
+    string baseName = "";
+    Uint nNames = 0;
+
+    AnalysisOptions options;
+    options.nThreads = 1;
+    options.SinglePass = false;
+    options.Pipeline = false;
+    options.PrefetchDepth = PIPEDEPTH;
+    options.CacheSizeMB = 0;
+    options.MakeHitCache = false;
+    options.CheckpointPeriod = 0;
+    options.SaveFits = true;
+
+    string scanDir = "";
+    Uint nSteps = SCANSTEPS;
+
+    bool partial = false;
+    bool peak = false;
+    bool merge = false;
+    bool follow = false;
+    Uint period = FOLLOWPERIOD;
+    Uint idle = FOLLOWIDLE;
+    Uint firstEntry = 0;
+    Uint lastEntry = ALLENTRIES;
+
+    bool repack = false;
+    RepackOptions packOptions;
+    packOptions.Compression = PACKLZ4;
+    packOptions.BasketKB = PACKBASKETKB;
+    packOptions.ClusterMB = PACKCLUSTERMB;
+
+    for(int a = 1; a < argc; a++){
+        string arg = argv[a];
+
+        if((arg == "-j" || arg == "--threads") && a+1 < argc){
+            options.nThreads = max(atoi(argv[++a]),1);
+        } else if(arg == "--single-pass"){
+            options.SinglePass = true;
+        } else if(arg == "--pipeline"){
+            options.Pipeline = true;
+        } else if(arg == "--prefetch" && a+1 < argc){
+            options.PrefetchDepth = max(atoi(argv[++a]),1);
+        } else if(arg == "--cache" && a+1 < argc){
+            options.CacheSizeMB = max(atoi(argv[++a]),0);
+        } else if(arg == "--hit-cache"){
+            options.MakeHitCache = true;
+        } else if(arg == "--checkpoint" && a+1 < argc){
+            options.CheckpointPeriod = max(atoi(argv[++a]),0);
+        } else if(arg == "--scan" && a+1 < argc){
+            scanDir = argv[++a];
+        } else if(arg == "--steps" && a+1 < argc){
+            nSteps = max(atoi(argv[++a]),1);
+        } else if(arg == "--entries" && a+1 < argc){
+            string range = argv[++a];
+            size_t colon = range.find(':');
+
+            partial = true;
+            firstEntry = strtoul(range.substr(0,colon).c_str(),NULL,10);
+            if(colon != string::npos && colon+1 < range.size())
+                lastEntry = strtoul(range.substr(colon+1).c_str(),NULL,10);
+        } else if(arg == "--peak"){
+            peak = true;
+        } else if(arg == "--merge"){
+            merge = true;
+        } else if(arg == "--follow" && a+1 < argc){
+            follow = true;
+            period = max(atoi(argv[++a]),1);
+        } else if(arg == "--idle" && a+1 < argc){
+            idle = max(atoi(argv[++a]),1);
+        } else if(arg == "--repack"){
+            repack = true;
+        } else if(arg == "--codec" && a+1 < argc){
+            packOptions.Compression = GetCompression(argv[++a]);
+        } else if(arg == "--basket" && a+1 < argc){
+            packOptions.BasketKB = max(atoi(argv[++a]),1);
+        } else if(arg == "--cluster" && a+1 < argc){
+            packOptions.ClusterMB = max(atoi(argv[++a]),1);
+        } else {
+            baseName = arg;
+            nNames++;
+        }
+    }
+
+    if(scanDir != "" && nNames == 0){
+        //Remove the trailing / to build the file names
+        while(scanDir.size() > 1 && scanDir[scanDir.size()-1] == '/')
+            scanDir.erase(scanDir.size()-1);
+
+        ScanAnalysis(scanDir,options,nSteps);
+        return 0;
+    } else if(nNames != 1){
+        MSG_WARNING("[Offline] expects to have 1 file base name as parameter");
+        MSG_WARNING("[Offline] USAGE is : " + program + " [-j nThreads] [--single-pass] [--pipeline] [--prefetch N] [--cache MB] [--hit-cache] [--checkpoint s] filebasename");
+        MSG_WARNING("[Offline] or : " + program + " [options] [--steps N] --scan scandirectory");
+        MSG_WARNING("[Offline] or : " + program + " [options] --peak filebasename");
+        MSG_WARNING("[Offline] or : " + program + " [options] --entries first:last filebasename");
+        MSG_WARNING("[Offline] or : " + program + " --merge filebasename");
+        MSG_WARNING("[Offline] or : " + program + " --follow s [--idle s] filebasename");
+        MSG_WARNING("[Offline] or : " + program + " --repack [--codec lz4|zstd|zlib] [--basket kB] [--cluster MB] filebasename");
         return -1;
-    } else if(argc == 2){
-        converter << argv[1];
-        string baseName;
-        converter >> baseName;
-        converter.clear();
+    } else if(repack){
+        string daqName = baseName + "_DAQ.root";
+        if(existFile(daqName)) RepackDAQFile(baseName,packOptions);
+        else MSG_ERROR("[Offline] No DAQ file for run " + baseName);
+
+        return 0;
+    } else if(follow){
+        //The DAQ file may not be created yet
+        WritePath(baseName);
+        FollowAnalysis(baseName,options,period,idle);
 
+        string caenName = baseName + "_CAEN.root";
+        if(existFile(caenName)) GetCurrent(baseName);
+
+        return 0;
+    } else if(peak || partial){
+        vector<string> DAQFiles;
+        if(FindDAQFiles(baseName,DAQFiles) == 0) MSG_ERROR("[Offline] No DAQ file for run " + baseName);
+        else if(peak) PeakAnalysis(baseName,options);
+        else PartialAnalysis(baseName,options,firstEntry,lastEntry);
+
+        return 0;
+    } else {
         //Write in the files of the RUN directory the path to the files
         //in the HVSCAN directory to know where to write the logs
         WritePath(baseName);
 
         //Start the needed analysis tools - check if the ROOT files exist
-        string daqName = baseName + "_DAQ.root";
-        if(existFile(daqName)) OfflineAnalysis(baseName);
+        //The partial results can be merged without the DAQ files. A run
+        //can be written into several DAQ files, baseName_DAQ_N.root
+        vector<string> DAQFiles;
+        if(merge) MergeAnalysis(baseName,options);
+        else if(FindDAQFiles(baseName,DAQFiles) > 0) OfflineAnalysis(baseName,options);
         else MSG_ERROR("[Offline] No DAQ file for run " + baseName);
 
         string caenName = baseName + "_CAEN.root";
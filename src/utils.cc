@@ -19,6 +19,10 @@
 #include <cstdio>
 #include <map>
 #include <algorithm>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "TFile.h"
 #include "TTree.h"
@@ -27,6 +31,8 @@
 #include "TStyle.h"
 #include "THistPainter.h"
 #include "TMath.h"
+#include "TROOT.h"
+#include "Math/MinimizerOptions.h"
 
 #include "../include/types.h"
 #include "../include/utils.h"
@@ -123,6 +129,30 @@ bool existFile(string ROOTName){
     return (ROOTFile.IsOpen());
 }
 
+// ****************************************************************************************************
+// *    Uint FindDAQFiles(string baseName, vector<string>& files)
+//
+//  Lists the DAQ files of the run baseName : baseName_DAQ.root followed by the parts
+//  baseName_DAQ_1.root, baseName_DAQ_2.root, ... written when the data of a run gets too large for a
+//  single file. The parts are numbered without gaps. Returns the number of files found.
+// ****************************************************************************************************
+
+Uint FindDAQFiles(string baseName, vector<string>& files){
+    files.clear();
+
+    string daqName = baseName + "_DAQ.root";
+    if(existFile(daqName)) files.push_back(daqName);
+
+    for(Uint part = 1; ; part++){
+        string partName = baseName + "_DAQ_" + intToString(part) + ".root";
+
+        if(existFile(partName)) files.push_back(partName);
+        else break;
+    }
+
+    return files.size();
+}
+
 // ****************************************************************************************************
 // *    void WritePath(string baseName)
 //
@@ -148,15 +178,16 @@ void WritePath(string baseName){
 // *    void SetTitleName(string rpcID, Uint partition, char* Name, char* Title,
 // *                      string Namebase, string Titlebase)
 //
-//  Builds the name and title of ROOT objects.
+//  Builds the name and title of ROOT objects. The partitions are labelled A, B, C... following their
+//  index.
 // ****************************************************************************************************
 
 void SetTitleName(string rpcID, Uint partition, char* Name, char* Title,
                   string Namebase, string Titlebase){
 
-    string P[4] = {"A","B","C","D"};
-    sprintf(Name,"%s_%s_%s",Namebase.c_str(),rpcID.c_str(),P[partition].c_str());
-    sprintf(Title,"%s %s_%s",Titlebase.c_str(),rpcID.c_str(),P[partition].c_str());
+    string P(1,(char)('A'+partition));
+    sprintf(Name,"%s_%s_%s",Namebase.c_str(),rpcID.c_str(),P.c_str());
+    sprintf(Title,"%s %s_%s",Titlebase.c_str(),rpcID.c_str(),P.c_str());
 }
 
 // ****************************************************************************************************
@@ -285,3 +316,237 @@ void SetTH2(TH2* H, string xtitle, string ytitle, string ztitle){
     H->SetYTitle(ytitle.c_str());
     H->SetZTitle(ztitle.c_str());
 }
+
+// ****************************************************************************************************
+// *    void DeleteHistos(GIFH1Array& H)
+// *    void DeleteHistos(GIFH2Array& H)
+//
+//  Deletes the histograms of every partition of H. The histograms are detached from ROOT's
+//  directories and are owned by the analysis. Partitions without histogram are skipped.
+// ****************************************************************************************************
+
+void DeleteHistos(GIFH1Array& H){
+    for(Uint i = 0; i < H.size(); i++){
+        delete H.rpc[i];
+        H.rpc[i] = NULL;
+    }
+}
+
+void DeleteHistos(GIFH2Array& H){
+    for(Uint i = 0; i < H.size(); i++){
+        delete H.rpc[i];
+        H.rpc[i] = NULL;
+    }
+}
+
+// ****************************************************************************************************
+// *    void EnableParallelFits(string& minimizer, string& algorithm)
+//
+//  Prepares ROOT for fits done by several threads at once. TMinuit relies on a global instance and
+//  can't be shared by threads contrary to Minuit2 that becomes the default minimizer. The previous
+//  default minimizer and algorithm are saved into minimizer and algorithm. The calls can be nested,
+//  also from several threads (HV steps analysed at once) : only the outermost call changes the
+//  default minimizer.
+// ****************************************************************************************************
+
+static mutex ParallelFitsMutex;
+static Uint  nParallelFits = 0;
+
+void EnableParallelFits(string& minimizer, string& algorithm){
+    lock_guard<mutex> lock(ParallelFitsMutex);
+
+    if(nParallelFits++ > 0) return;
+
+    minimizer = ROOT::Math::MinimizerOptions::DefaultMinimizerType();
+    algorithm = ROOT::Math::MinimizerOptions::DefaultMinimizerAlgo();
+
+    ROOT::Math::MinimizerOptions::SetDefaultMinimizer(PARALLELMINIMIZER.c_str());
+    ROOT::EnableThreadSafety();
+}
+
+// ****************************************************************************************************
+// *    void RestoreMinimizer(string minimizer, string algorithm)
+//
+//  Sets back the default minimizer saved by EnableParallelFits(...) once the outermost call is over.
+// ****************************************************************************************************
+
+void RestoreMinimizer(string minimizer, string algorithm){
+    lock_guard<mutex> lock(ParallelFitsMutex);
+
+    if(--nParallelFits > 0) return;
+
+    ROOT::Math::MinimizerOptions::SetDefaultMinimizer(minimizer.c_str(),algorithm.c_str());
+}
+
+// ****************************************************************************************************
+// *    void SetTreeReading(TTree* dataTree, bool isNewFormat, Uint first, Uint last, Uint cacheMB)
+//
+//  Only enables the branches of the RAWData tree the analysis needs (channels, time stamps and the
+//  quality flag of new format files) so that the other ones are never read nor decompressed. When
+//  cacheMB is not 0, the TTreeCache of the tree is set to cacheMB MB. The cache is then filled with
+//  the enabled branches for the entries [first,last[ only.
+// ****************************************************************************************************
+
+void SetTreeReading(TTree* dataTree, bool isNewFormat, Uint first, Uint last, Uint cacheMB){
+    dataTree->SetBranchStatus("*",false);
+    dataTree->SetBranchStatus("TDC_channel",true);
+    dataTree->SetBranchStatus("TDC_TimeStamp",true);
+
+    if(isNewFormat)
+        dataTree->SetBranchStatus("Quality_flag",true);
+
+    if(cacheMB > 0)
+        dataTree->SetCacheSize((Long64_t)cacheMB*1024*1024);
+
+    if(dataTree->GetCacheSize() > 0){
+        dataTree->AddBranchToCache("TDC_channel",true);
+        dataTree->AddBranchToCache("TDC_TimeStamp",true);
+
+        if(isNewFormat)
+            dataTree->AddBranchToCache("Quality_flag",true);
+
+        dataTree->SetCacheEntryRange(first,last);
+        dataTree->StopCacheLearningPhase();
+    }
+}
+
+// ****************************************************************************************************
+// *    void ReadRAWData(TTree* dataTree, bool isNewFormat, RAWDataBuffer& buffer)
+//
+//  Loads the whole content of the RAWData tree into memory. The hits of all the entries are stored
+//  one after the other and the position of the first hit of each entry is kept to replay them.
+// ****************************************************************************************************
+
+void ReadRAWData(TTree* dataTree, bool isNewFormat, RAWDataBuffer& buffer){
+    RAWData data;
+
+    data.QFlag = GOOD;
+    data.TDCCh = new vector<Uint>;
+    data.TDCTS = new vector<float>;
+    data.TDCCh->clear();
+    data.TDCTS->clear();
+
+    dataTree->SetBranchAddress("TDC_channel",    &data.TDCCh);
+    dataTree->SetBranchAddress("TDC_TimeStamp",  &data.TDCTS);
+
+    if(isNewFormat)
+        dataTree->SetBranchAddress("Quality_flag", &data.QFlag);
+
+    Uint nEntries = dataTree->GetEntries();
+
+    buffer.EntryOffset.clear();
+    buffer.QFlag.clear();
+    buffer.TDCCh.clear();
+    buffer.TDCTS.clear();
+    buffer.EntryOffset.reserve(nEntries+1);
+    buffer.QFlag.reserve(nEntries);
+
+    for(Uint i = 0; i < nEntries; i++){
+        dataTree->GetEntry(i);
+
+        buffer.EntryOffset.push_back(buffer.TDCCh.size());
+        buffer.QFlag.push_back(data.QFlag);
+        buffer.TDCCh.insert(buffer.TDCCh.end(),data.TDCCh->begin(),data.TDCCh->end());
+        buffer.TDCTS.insert(buffer.TDCTS.end(),data.TDCTS->begin(),data.TDCTS->end());
+    }
+    buffer.EntryOffset.push_back(buffer.TDCCh.size());
+
+    dataTree->ResetBranchAddresses();
+    delete data.TDCCh;
+    delete data.TDCTS;
+}
+
+// ****************************************************************************************************
+// *    void ReadRAWFiles(const vector<string>& daqNames, bool isNewFormat, Uint cacheMB,
+// *                      RAWDataBuffer& buffer)
+//
+//  Same as ReadRAWData(...) for the DAQ files daqNames of a run. Each file is read by a thread of its
+//  own into a buffer of its own. The buffers are then appended following the order of the files, as
+//  the entries of the chain of the RAWData trees, and freed as soon as they are copied.
+// ****************************************************************************************************
+
+void ReadRAWFiles(const vector<string>& daqNames, bool isNewFormat, Uint cacheMB,
+                  RAWDataBuffer& buffer){
+    Uint nFiles = daqNames.size();
+    vector<RAWDataBuffer> FileBuffers(nFiles);
+    vector<thread> Readers;
+
+    ROOT::EnableThreadSafety();
+
+    for(Uint f = 0; f < nFiles; f++){
+        Readers.push_back(thread([&,f](){
+            TFile daqFile(daqNames[f].c_str());
+            TTree* dataTree = (TTree*)daqFile.Get("RAWData");
+            if(dataTree == NULL) return;
+
+            SetTreeReading(dataTree,isNewFormat,0,dataTree->GetEntries(),cacheMB);
+            ReadRAWData(dataTree,isNewFormat,FileBuffers[f]);
+            daqFile.Close();
+        }));
+    }
+
+    for(Uint f = 0; f < nFiles; f++)
+        Readers[f].join();
+
+    //The first file is moved into place, the next ones are appended with
+    //their hit positions shifted by the hits of the files before them
+    buffer = RAWDataBuffer();
+
+    for(Uint f = 0; f < nFiles; f++){
+        RAWDataBuffer& part = FileBuffers[f];
+        Uint nEntries = part.QFlag.size();
+
+        if(f == 0){
+            swap(buffer,part);
+            if(!buffer.EntryOffset.empty()) buffer.EntryOffset.pop_back();
+            continue;
+        }
+
+        Uint hitOffset = buffer.TDCCh.size();
+
+        for(Uint e = 0; e < nEntries; e++)
+            buffer.EntryOffset.push_back(hitOffset + part.EntryOffset[e]);
+
+        buffer.QFlag.insert(buffer.QFlag.end(),part.QFlag.begin(),part.QFlag.end());
+        buffer.TDCCh.insert(buffer.TDCCh.end(),part.TDCCh.begin(),part.TDCCh.end());
+        buffer.TDCTS.insert(buffer.TDCTS.end(),part.TDCTS.begin(),part.TDCTS.end());
+
+        part = RAWDataBuffer();
+    }
+    buffer.EntryOffset.push_back(buffer.TDCCh.size());
+}
+
+// ****************************************************************************************************
+// *    unsigned long long GetFileHash(string path)
+//
+//  Returns a FNV-1a hash of the content of the file path used to know if a configuration file has
+//  changed. A missing file gives the hash of an empty file.
+// ****************************************************************************************************
+
+unsigned long long GetFileHash(string path){
+    unsigned long long hash = 14695981039346656037ULL;
+    ifstream file(path.c_str(), ios::in | ios::binary);
+    char c;
+
+    while(file.get(c)){
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+// ****************************************************************************************************
+// *    void PrefetchFile(string fileName)
+//
+//  Asks the system to start reading fileName into memory in the background so that it is already
+//  cached when it gets analysed. Nothing is done if the file doesn't exist.
+// ****************************************************************************************************
+
+void PrefetchFile(string fileName){
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if(fd < 0) return;
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}